@@ -5,8 +5,14 @@
 
 
 #include "versioned_graph_test.h"
+#include "versioned_graph_freeze.h"
+#include "versioned_graph_shared.h"
+#include "versioned_graph_view.h"
 #include <iostream>
+#include <thread>
 #include <utility>
+#include <boost/graph/breadth_first_search.hpp>
+#include <boost/graph/dijkstra_shortest_paths.hpp>
 #include <boost/graph/graph_utility.hpp>
 #include <boost/graph/topological_sort.hpp>
 
@@ -115,9 +121,19 @@ TEST(VersionedGraphTest, withoutTypes) {
     ASSERT_EQ(4,num_vertices(sg));
     ASSERT_EQ(5,num_edges(sg));
     auto iterv = vertices(sg);
-    ASSERT_EQ(4,distance(iterv.first,iterv.second));
+    ASSERT_EQ(4,std::distance(iterv.first,iterv.second));
     auto itere = edges(sg);
-    ASSERT_EQ(5,distance(itere.first,itere.second));
+    ASSERT_EQ(5,std::distance(itere.first,itere.second));
+    // no_property bundles are returned by value, not by reference to temporary
+    ::testing::StaticAssertTypeEq<boost::no_property, decltype(sg.get_latest_from_history(v1))>();
+    ::testing::StaticAssertTypeEq<boost::no_property, decltype(sg.get_latest_from_history(*itere.first))>();
+    ::testing::StaticAssertTypeEq<boost::no_property, decltype(sg.get_latest_from_history())>();
+    ::testing::StaticAssertTypeEq<boost::no_property, decltype(sg.get_from_history(simple_graph::revision::create(1)))>();
+    ::testing::StaticAssertTypeEq<boost::no_property, decltype(as_of(sg,simple_graph::revision::create(1))[graph_bundle])>();
+    sg.get_latest_from_history(v1);
+    sg.get_latest_from_history(*itere.first);
+    sg.get_latest_from_history();
+    as_of(sg,simple_graph::revision::create(1))[graph_bundle];
     erase_history(sg);
     ASSERT_EQ(4,num_vertices(sg));
     ASSERT_EQ(5,num_edges(sg));
@@ -224,3 +240,1354 @@ TEST(VersionedGraphTest, checkTopologicalSort) {
     ASSERT_EQ(5,std::distance(topo_order.begin(),topo_order.end()));
 
 }
+
+TEST(VersionedGraphTest, commitModifiedOnly) {
+    using namespace boost;
+    typedef versioned_graph<adjacency_list<boost::vecS, boost::listS, boost::bidirectionalS,int,int,long>> simple_graph;
+    typedef typename boost::graph_traits<simple_graph>::vertex_descriptor vertex_descriptor;
+    simple_graph sg;
+    vertex_descriptor v1 = add_vertex(1,sg);
+    vertex_descriptor v2 = add_vertex(2,sg);
+    vertex_descriptor v3 = add_vertex(3,sg);
+    auto e1 = add_edge(v1,v2,12,sg).first;
+    auto e2 = add_edge(v2,v3,23,sg).first;
+    commit(sg);
+    const simple_graph& csg = sg;
+    ASSERT_EQ(2,csg[v2]); // const access does not mark vertex as modified
+    sg[v1] = 11;
+    sg[e2] = 230;
+    sg[v3] = 3; // same value, nothing to store
+    commit(sg);
+    ASSERT_EQ(2,csg.get_history(v1).size());
+    ASSERT_EQ(1,csg.get_history(v2).size());
+    ASSERT_EQ(1,csg.get_history(v3).size());
+    ASSERT_EQ(1,csg.get_history(e1).size());
+    ASSERT_EQ(2,csg.get_history(e2).size());
+    sg[v2] = 22;
+    revert_changes(sg);
+    ASSERT_EQ(2,sg[v2]);
+    sg[v2] = 21;
+    commit(sg);
+    ASSERT_EQ(2,csg.get_history(v2).size());
+    undo_commit(sg);
+    ASSERT_EQ(2,sg[v2]);
+    ASSERT_EQ(11,sg[v1]);
+    ASSERT_EQ(230,sg[e2]);
+}
+
+struct Weight {
+    int value; // no comparison operators on purpose
+};
+
+struct Length {
+    int value;
+};
+
+TEST(VersionedGraphTest, bundlePropertyMap) {
+    using namespace boost;
+    typedef versioned_graph<adjacency_list<boost::vecS, boost::vecS, boost::undirectedS,Weight,Length>> simple_graph;
+    simple_graph sg;
+    auto v1 = add_vertex(Weight{1},sg);
+    auto v2 = add_vertex(Weight{2},sg);
+    auto e = add_edge(v1,v2,Length{12},sg).first;
+    commit(sg);
+    auto vertex_weight = get(&Weight::value,sg);
+    auto edge_length = get(&Length::value,sg);
+    put(vertex_weight,v2,20);
+    put(edge_length,e,120);
+    put(&Weight::value,sg,v1,10);
+    ASSERT_EQ(20,get(vertex_weight,v2));
+    commit(sg);
+    const simple_graph& csg = sg;
+    ASSERT_EQ(2,csg.get_history(v1).size());
+    ASSERT_EQ(2,csg.get_history(v2).size());
+    ASSERT_EQ(2,csg.get_history(e).size());
+    ASSERT_EQ(10,get(&Weight::value,csg,v1));
+    ASSERT_EQ(20,get(get(&Weight::value,csg),v2));
+    put(vertex_weight,v2,21);
+    revert_changes(sg);
+    ASSERT_EQ(20,sg[v2].value);
+    undo_commit(sg);
+    ASSERT_EQ(1,sg[v1].value);
+    ASSERT_EQ(2,sg[v2].value);
+    ASSERT_EQ(12,sg[e].value);
+    ASSERT_EQ(1,csg.get_history(v1).size());
+    commit(sg);
+    ASSERT_EQ(2,csg.get_history(v1).size()); // non const read of type without != is a write
+}
+
+TEST(VersionedGraphTest, revertJournal) {
+    using namespace boost;
+    typedef versioned_graph<adjacency_list<boost::vecS, boost::listS, boost::bidirectionalS,int,int,long>> simple_graph;
+    typedef typename boost::graph_traits<simple_graph>::vertex_descriptor vertex_descriptor;
+    simple_graph sg;
+    vertex_descriptor v1 = add_vertex(1,sg);
+    vertex_descriptor v2 = add_vertex(2,sg);
+    vertex_descriptor v3 = add_vertex(3,sg);
+    add_edge(v1,v2,12,sg);
+    add_edge(v2,v3,23,sg);
+    add_edge(v3,v1,31,sg);
+    commit(sg);
+    for(int i=0;i<3;++i){
+        vertex_descriptor v4 = add_vertex(4,sg);
+        add_edge(v4,v1,41,sg);
+        add_edge(v2,v4,24,sg);
+        sg[v4] = 44;
+        sg[v1] = 10+i;
+        sg[edge(v1,v2,sg).first] = 120+i;
+        remove_edge(v2,v3,sg);
+        clear_vertex(v3,sg);
+        remove_vertex(v3,sg);
+        ASSERT_EQ(3,num_vertices(sg));
+        ASSERT_EQ(3,num_edges(sg));
+        ASSERT_EQ(1,in_degree(v1,sg));
+        revert_changes(sg);
+        ASSERT_EQ(3,num_vertices(sg));
+        ASSERT_EQ(3,num_edges(sg));
+        ASSERT_EQ(1,sg[v1]);
+        ASSERT_EQ(12,sg[edge(v1,v2,sg).first]);
+        ASSERT_TRUE(edge(v2,v3,sg).second);
+        ASSERT_TRUE(edge(v3,v1,sg).second);
+        ASSERT_EQ(1,out_degree(v2,sg));
+        ASSERT_EQ(1,in_degree(v1,sg));
+        ASSERT_EQ(1,in_degree(v3,sg));
+        ASSERT_EQ(3,num_vertices(sg.get_base_graph()));
+        ASSERT_EQ(3,num_edges(sg.get_base_graph()));
+    }
+}
+
+template<typename graph>
+std::multiset<std::string> describe_state(const graph& g){
+    std::multiset<std::string> state;
+    auto vi = vertices(g);
+    for(auto it = vi.first; it != vi.second; ++it){
+        state.insert("v" + std::to_string(g[*it]) + " deg " + std::to_string(out_degree(*it,g)));
+    }
+    auto ei = edges(g);
+    for(auto it = ei.first; it != ei.second; ++it){
+        state.insert("e" + std::to_string(g[source(*it,g)]) + "-" + std::to_string(g[target(*it,g)])
+                     + " " + std::to_string(g[*it]));
+    }
+    state.insert("g" + std::to_string(g[graph_bundle]));
+    return state;
+}
+
+TEST(VersionedGraphTest, undoToRevision) {
+    using namespace boost;
+    typedef versioned_graph<adjacency_list<boost::multisetS, boost::listS, boost::undirectedS,int,int,long>> simple_graph;
+    typedef typename boost::graph_traits<simple_graph>::vertex_descriptor vertex_descriptor;
+    typedef typename simple_graph::revision revision;
+    simple_graph sg;
+    std::vector<vertex_descriptor> vs;
+    for(int i=0;i<6;++i){
+        vs.push_back(add_vertex(i,sg));
+    }
+    for(int i=0;i<6;++i){
+        add_edge(vs[i],vs[(i+1)%6],i,sg);
+    }
+    sg[graph_bundle] = 1;
+    commit(sg);
+    std::vector<std::multiset<std::string>> states;
+    states.push_back(describe_state(sg));
+    for(int step=0;step<5;++step){
+        vertex_descriptor v = add_vertex(10+step,sg);
+        add_edge(v,vs[step],20+step,sg);
+        add_edge(v,v,30+step,sg);
+        sg[vs[step+1]] = 100+step;
+        sg[edge(vs[0],vs[1],sg).first] = 200+step;
+        remove_edge(vs[5-step],vs[(6-step)%6],sg);
+        sg[graph_bundle] = 2+step;
+        vs.push_back(v);
+        commit(sg);
+        states.push_back(describe_state(sg));
+    }
+    ASSERT_EQ(revision::create(7),sg.get_current_rev());
+    sg[vs[0]] = 1000;
+    add_vertex(1001,sg);
+
+    simple_graph copy(sg);
+    undo_commit(copy);
+    ASSERT_EQ(states[4],describe_state(copy));
+    undo_commit(copy);
+    undo_commit(copy);
+    ASSERT_EQ(states[2],describe_state(copy));
+
+    undo_to(sg,revision::create(3));
+    ASSERT_EQ(revision::create(4),sg.get_current_rev());
+    ASSERT_EQ(states[2],describe_state(sg));
+    ASSERT_EQ(describe_state(copy),describe_state(sg));
+    ASSERT_EQ(8,num_vertices(sg.get_base_graph()));
+    ASSERT_EQ(8,num_vertices(sg));
+
+    sg[vs[2]] = 7;
+    commit(sg);
+    ASSERT_EQ(states[1],describe_state(as_of(sg,revision::create(2))));
+    undo_to(sg,revision::create(2));
+    ASSERT_EQ(revision::create(3),sg.get_current_rev());
+    ASSERT_EQ(states[1],describe_state(sg));
+
+    // first commit cannot be undone, revision 0 is treated as revision 1
+    undo_to(sg,revision::create(0));
+    ASSERT_EQ(revision::create(2),sg.get_current_rev());
+    ASSERT_EQ(states[0],describe_state(sg));
+    ASSERT_EQ(6,num_vertices(sg.get_base_graph()));
+    ASSERT_EQ(6,num_edges(sg.get_base_graph()));
+}
+
+TEST(VersionedGraphTest, edgeIdentity) {
+    using namespace boost;
+    typedef versioned_graph<adjacency_list<boost::vecS, boost::vecS, boost::directedS,int,int>> simple_graph;
+    simple_graph sg(2);
+    auto uv = add_edge(0,1,1,sg).first;
+    auto vu = add_edge(1,0,2,sg).first;
+    auto uu = add_edge(0,0,3,sg).first;
+    auto vv = add_edge(1,1,4,sg).first;
+    auto parallel = add_edge(0,1,5,sg).first;
+    commit(sg);
+    sg[uv] = 10;
+    sg[uu] = 30;
+    remove_edge(parallel,sg);
+    commit(sg);
+    const simple_graph& csg = sg;
+    ASSERT_EQ(2,csg.get_history(uv).size());
+    ASSERT_EQ(1,csg.get_history(vu).size());
+    ASSERT_EQ(2,csg.get_history(uu).size());
+    ASSERT_EQ(1,csg.get_history(vv).size());
+    ASSERT_EQ(4,num_edges(sg));
+    undo_commit(sg);
+    ASSERT_EQ(5,num_edges(sg));
+    ASSERT_EQ(1,sg[uv]);
+    ASSERT_EQ(2,sg[vu]);
+    ASSERT_EQ(3,sg[uu]);
+    ASSERT_EQ(5,sg[parallel]);
+
+    typedef versioned_graph<adjacency_matrix<boost::directedS>> matrix_graph;
+    typedef typename boost::graph_traits<matrix_graph>::vertex_descriptor vertex_descriptor;
+    matrix_graph mg(2);
+    vertex_descriptor u = 0, v = 1;
+    add_edge(u,v,mg);
+    add_edge(v,u,mg);
+    commit(mg);
+    remove_edge(u,v,mg);
+    ASSERT_TRUE(edge(v,u,mg).second);
+    ASSERT_FALSE(edge(u,v,mg).second);
+    revert_changes(mg);
+    ASSERT_TRUE(edge(u,v,mg).second);
+    ASSERT_EQ(2,num_edges(mg));
+}
+
+TEST(VersionedGraphTest, flatEdgeMap) {
+    boost::detail::flat_edge_map<int> map;
+    for(std::uintptr_t k=1;k<=1000;++k){
+        ASSERT_TRUE(map.insert(std::make_pair(k*16,int(k))).second);
+    }
+    ASSERT_FALSE(map.insert(std::make_pair(std::uintptr_t(16),0)).second);
+    ASSERT_EQ(1000,map.size());
+    for(std::uintptr_t k=1;k<=1000;k+=2){
+        auto it = map.find(k*16);
+        ASSERT_TRUE(it!=map.end());
+        map.erase(it);
+    }
+    ASSERT_EQ(500,map.size());
+    for(std::uintptr_t k=1;k<=1000;++k){
+        auto it = map.find(k*16);
+        if(k%2){
+            ASSERT_TRUE(it==map.end());
+        } else {
+            ASSERT_TRUE(it!=map.end());
+            ASSERT_EQ(int(k),it->second);
+        }
+    }
+}
+
+/**
+ * runs the same changes on graph, returns state after every step
+ */
+template<typename graph>
+std::vector<std::multiset<std::string>> history_scenario(){
+    using namespace boost;
+    typedef typename graph_traits<graph>::vertex_descriptor vertex_descriptor;
+    typedef typename graph::vertex_list_selector vertex_list_selector;
+    graph g;
+    std::vector<std::multiset<std::string>> states;
+    std::vector<vertex_descriptor> vs;
+    for(int i=0;i<7;++i){
+        vs.push_back(add_vertex(i,g));
+    }
+    for(int i=0;i<6;++i){
+        add_edge(vs[i],vs[(i+1)%6],i,g);
+    }
+    g[graph_bundle] = 1;
+    commit(g);
+    states.push_back(describe_state(g));
+
+    vertex_descriptor v6 = vs[6];
+    add_edge(v6,vs[0],60,g);
+    add_edge(v6,v6,66,g);
+    g[edge(vs[0],vs[1],g).first] = 100;
+    remove_edge(vs[3],vs[4],g);
+    auto temporary = add_edge(vs[1],vs[3],13,g).first;
+    remove_edge(temporary,g);
+    add_edge(vs[0],vs[1],101,g); // parallel edge if allowed
+    if(!std::is_same<vertex_list_selector,vecS>::value){ // vecS vertices cannot be removed
+        vertex_descriptor v7 = add_vertex(7,g);
+        add_edge(v7,v6,76,g);
+        clear_vertex(v7,g);
+        remove_vertex(v7,g);
+    }
+    commit(g);
+    states.push_back(describe_state(g));
+
+    clear_vertex(vs[2],g);
+    remove_vertex(vs[2],g);
+    g[vs[5]] = 55;
+    add_edge(vs[5],v6,56,g);
+    g[graph_bundle] = 3;
+    revert_changes(g);
+    if(describe_state(g)!=states.back()){
+        ADD_FAILURE() << "revert_changes() did not restore state";
+    }
+    clear_vertex(vs[2],g);
+    remove_vertex(vs[2],g);
+    g[vs[5]] = 55;
+    g[edge(v6,v6,g).first] = 67;
+    commit(g);
+    states.push_back(describe_state(g));
+
+    undo_commit(g);
+    states.push_back(describe_state(g));
+    undo_commit(g);
+    states.push_back(describe_state(g));
+    return states;
+}
+
+template<typename base_graph>
+void check_intrusive_history(){
+    using namespace boost;
+    auto keyed = history_scenario<versioned_graph<base_graph>>();
+    auto intrusive = history_scenario<versioned_graph<typename intrusive_edge_history<base_graph>::type>>();
+    ASSERT_EQ(5,keyed.size());
+    ASSERT_TRUE(keyed[1]==keyed[3]);
+    ASSERT_TRUE(keyed[0]==keyed[4]);
+    ASSERT_TRUE(keyed==intrusive);
+}
+
+TEST(VersionedGraphTest, intrusiveEdgeHistory) {
+    using namespace boost;
+    check_intrusive_history<adjacency_list<vecS,vecS,directedS,int,int,int>>();
+    check_intrusive_history<adjacency_list<listS,listS,bidirectionalS,int,int,int>>();
+    check_intrusive_history<adjacency_list<setS,listS,undirectedS,int,int,int>>();
+    check_intrusive_history<adjacency_list<multisetS,vecS,bidirectionalS,int,int,int>>();
+    check_intrusive_history<adjacency_list<hash_setS,listS,directedS,int,int,int>>();
+    check_intrusive_history<adjacency_list<vecS,listS,undirectedS,int,int,int>>();
+
+    typedef versioned_graph<intrusive_edge_history<adjacency_list<listS,listS,undirectedS,int,int>>::type> simple_graph;
+    static_assert(std::is_same<int,edge_bundle_type<simple_graph>::type>::value,"edge bundle has to stay the same");
+    simple_graph g;
+    auto u = add_vertex(1,g), v = add_vertex(2,g);
+    auto e = add_edge(u,v,12,g).first;
+    commit(g);
+    g[e] = 21;
+    commit(g);
+    const simple_graph& cg = g;
+    ASSERT_EQ(2,cg.get_history(e).size());
+    ASSERT_EQ(2,cg.get_history(edge(v,u,g).first).size());
+}
+
+TEST(VersionedGraphTest, deletedFiltering) {
+    using namespace boost;
+    typedef versioned_graph<adjacency_list<vecS,listS,undirectedS,int,int>> simple_graph;
+    typedef graph_traits<simple_graph>::vertex_descriptor vertex_descriptor;
+    simple_graph g;
+    vertex_descriptor v[4];
+    for(int i=0;i<4;++i){
+        v[i] = add_vertex(i,g);
+    }
+    auto e = add_edge(v[0],v[1],1,g).first;
+    add_edge(v[1],v[2],2,g);
+    add_edge(v[2],v[3],3,g);
+    commit(g);
+    ASSERT_FALSE(g.has_deleted_vertices());
+    ASSERT_FALSE(g.has_deleted_edges());
+    remove_edge(e,g);
+    clear_vertex(v[3],g);
+    remove_vertex(v[3],g);
+    ASSERT_TRUE(g.has_deleted_vertices());
+    ASSERT_TRUE(g.has_deleted_edges());
+    ASSERT_FALSE(g.is_visible(e));
+    ASSERT_FALSE(g.is_visible(v[3]));
+    ASSERT_EQ(3,std::distance(vertices(g).first,vertices(g).second));
+    ASSERT_EQ(1,std::distance(edges(g).first,edges(g).second));
+    ASSERT_EQ(1,std::distance(out_edges(v[1],g).first,out_edges(v[1],g).second));
+    ASSERT_EQ(1,std::distance(adjacent_vertices(v[1],g).first,adjacent_vertices(v[1],g).second));
+    // edge created and removed in one revision leaves nothing to filter
+    auto f = add_edge(v[0],v[2],4,g).first;
+    remove_edge(f,g);
+    ASSERT_EQ(1,std::distance(edges(g).first,edges(g).second));
+    revert_changes(g);
+    ASSERT_FALSE(g.has_deleted_vertices());
+    ASSERT_FALSE(g.has_deleted_edges());
+    ASSERT_EQ(4,std::distance(vertices(g).first,vertices(g).second));
+    ASSERT_EQ(3,std::distance(edges(g).first,edges(g).second));
+}
+
+TEST(VersionedGraphTest, aliveBitset) {
+    boost::detail::alive_bitset set;
+    for(std::size_t i=0;i<200;++i){
+        set.set(i);
+    }
+    for(std::size_t i=0;i<200;++i){
+        if(i%3){
+            set.reset(i);
+        }
+    }
+    ASSERT_EQ(200,set.size());
+    ASSERT_EQ(67,set.count());
+    ASSERT_EQ(63,set.next(61));
+    ASSERT_EQ(198,set.next(196));
+    ASSERT_EQ(200,set.next(199));
+    ASSERT_EQ(195,set.prev(198));
+    ASSERT_EQ(0,set.prev(1));
+    ASSERT_EQ(129,set.select(43));
+    ASSERT_EQ(200,set.select(67));
+    ASSERT_EQ(43,set.rank(129));
+    ASSERT_EQ(44,set.rank(130));
+    ASSERT_EQ(67,set.rank(200));
+    ASSERT_EQ(0,set.rank(0));
+    set.erase(63); // bit 64 moves to 63 and bits of next words follow
+    ASSERT_EQ(199,set.size());
+    ASSERT_FALSE(set.test(63));
+    ASSERT_TRUE(set.test(65));
+    ASSERT_TRUE(set.test(128));
+    ASSERT_EQ(66,set.count());
+    ASSERT_EQ(197,set.prev(199));
+    ASSERT_EQ(65,set.select(21));
+    ASSERT_EQ(22,set.rank(66));
+    // rank and select follow every change, compared with linear count
+    std::srand(7);
+    for(int step=0;step<2000;++step){
+        std::size_t i = std::rand()%700;
+        if(std::rand()%3){
+            set.set(i);
+        } else if(i<set.size()){
+            set.reset(i);
+        }
+        std::size_t n = 0;
+        for(std::size_t k=0;k<set.size();++k){
+            if(set.test(k)){
+                ASSERT_EQ(n,set.rank(k));
+                ASSERT_EQ(k,set.select(n));
+                ++n;
+            }
+        }
+        ASSERT_EQ(n,set.count());
+        ASSERT_EQ(set.size(),set.select(n));
+    }
+}
+
+TEST(VersionedGraphTest, aliveVertices) {
+    using namespace boost;
+    typedef versioned_graph<adjacency_list<vecS,vecS,bidirectionalS,int,int>> simple_graph;
+    typedef graph_traits<simple_graph>::vertex_descriptor vertex_descriptor;
+    simple_graph g(150);
+    commit(g);
+    for(vertex_descriptor v=0;v<150;v+=2){
+        remove_vertex(v,g);
+    }
+    remove_vertex(vertex_descriptor(149),g);
+    ASSERT_EQ(74,num_vertices(g));
+    ASSERT_EQ(1,vertex(0,g));
+    ASSERT_EQ(147,vertex(73,g));
+    ASSERT_EQ(73,g.get_vertex_rank(147));
+    std::vector<vertex_descriptor> alive(vertices(g).first,vertices(g).second);
+    ASSERT_EQ(74,alive.size());
+    ASSERT_EQ(147,*--vertices(g).second);
+    for(std::size_t i=0;i<alive.size();++i){
+        ASSERT_EQ(2*i+1,alive[i]);
+    }
+    commit(g);
+    undo_commit(g);
+    ASSERT_EQ(150,num_vertices(g));
+    ASSERT_EQ(100,vertex(100,g));
+    ASSERT_EQ(150,std::distance(vertices(g).first,vertices(g).second));
+    simple_graph copy(g);
+    remove_vertex(vertex_descriptor(0),copy);
+    ASSERT_EQ(1,*vertices(copy).first);
+    ASSERT_EQ(0,*vertices(g).first);
+}
+
+TEST(VersionedGraphTest, edgeLookup) {
+    using namespace boost;
+    typedef versioned_graph<adjacency_list<setS,vecS,undirectedS,int,int>> set_graph;
+    set_graph sg(3);
+    add_edge(0,1,1,sg);
+    add_edge(1,2,2,sg);
+    commit(sg);
+    ASSERT_TRUE(edge(1,0,sg).second);
+    ASSERT_FALSE(edge(0,2,sg).second);
+    remove_edge(0,1,sg);
+    ASSERT_FALSE(edge(0,1,sg).second);
+    ASSERT_FALSE(edge(1,0,sg).second);
+    revert_changes(sg);
+    ASSERT_EQ(1,sg[edge(1,0,sg).first]);
+
+    typedef versioned_graph<adjacency_list<vecS,vecS,directedS,int,int>> multi_graph;
+    multi_graph mg(2);
+    auto first = add_edge(0,1,1,mg).first;
+    add_edge(0,1,2,mg);
+    commit(mg);
+    remove_edge(first,mg);
+    ASSERT_TRUE(edge(0,1,mg).second);
+    ASSERT_EQ(2,mg[edge(0,1,mg).first]);
+    ASSERT_FALSE(edge(1,0,mg).second);
+
+    typedef versioned_graph<adjacency_matrix<undirectedS>> matrix_graph;
+    typedef graph_traits<matrix_graph>::vertex_descriptor vertex_descriptor;
+    matrix_graph xg(3);
+    vertex_descriptor u = 0, v = 2;
+    add_edge(u,v,xg);
+    commit(xg);
+    remove_edge(v,u,xg);
+    ASSERT_FALSE(edge(u,v,xg).second);
+    undo_commit(xg);
+    ASSERT_TRUE(edge(v,u,xg).second);
+}
+
+TEST(VersionedGraphTest, adjacencyOverEdges) {
+    using namespace boost;
+    typedef versioned_graph<adjacency_list<listS,vecS,bidirectionalS,int,int>> simple_graph;
+    simple_graph g(3);
+    auto first = add_edge(0,1,1,g).first;
+    add_edge(0,1,2,g);
+    add_edge(0,2,3,g);
+    add_edge(2,1,4,g);
+    commit(g);
+    remove_edge(first,g);
+    remove_edge(2,1,g);
+    // parallel edge to 1 is still alive, each alive edge gives one neighbour
+    std::vector<std::size_t> adjacent(adjacent_vertices(0,g).first,adjacent_vertices(0,g).second);
+    ASSERT_EQ((std::vector<std::size_t>{1,2}),adjacent);
+    std::vector<std::size_t> inv_adjacent(inv_adjacent_vertices(1,g).first,inv_adjacent_vertices(1,g).second);
+    ASSERT_EQ((std::vector<std::size_t>{0}),inv_adjacent);
+    revert_changes(g);
+    ASSERT_EQ(3,std::distance(adjacent_vertices(0,g).first,adjacent_vertices(0,g).second));
+    ASSERT_EQ(3,std::distance(inv_adjacent_vertices(1,g).first,inv_adjacent_vertices(1,g).second));
+
+    typedef versioned_graph<adjacency_matrix<directedS>> matrix_graph;
+    typedef graph_traits<matrix_graph>::vertex_descriptor vertex_descriptor;
+    matrix_graph mg(3);
+    vertex_descriptor u = 0, v = 1, w = 2;
+    add_edge(u,v,mg);
+    add_edge(u,w,mg);
+    commit(mg);
+    remove_edge(u,v,mg);
+    ASSERT_EQ(w,*adjacent_vertices(u,mg).first);
+    ASSERT_EQ(1,std::distance(adjacent_vertices(u,mg).first,adjacent_vertices(u,mg).second));
+}
+
+template<typename graph>
+void check_clear_vertex(){
+    using namespace boost;
+    graph g(4);
+    typedef typename graph_traits<graph>::vertex_descriptor vertex_descriptor;
+    std::vector<vertex_descriptor> v(vertices(g).first,vertices(g).second);
+    add_edge(v[0],v[1],1,g);
+    add_edge(v[2],v[0],2,g);
+    add_edge(v[0],v[0],3,g);
+    add_edge(v[2],v[3],4,g);
+    commit(g);
+    add_edge(v[0],v[0],5,g); // self loop created in this revision is removed permanently
+    add_edge(v[3],v[0],6,g);
+    clear_vertex(v[0],g);
+    ASSERT_EQ(1,num_edges(g));
+    ASSERT_EQ(0,out_degree(v[0],g));
+    ASSERT_EQ(1,out_degree(v[2],g));
+    ASSERT_FALSE(edge(v[2],v[0],g).second);
+    ASSERT_TRUE(edge(v[2],v[3],g).second);
+    revert_changes(g);
+    ASSERT_EQ(4,num_edges(g));
+    ASSERT_TRUE(edge(v[0],v[0],g).second);
+    ASSERT_TRUE(edge(v[2],v[0],g).second);
+    clear_out_edges(v[2],g);
+    ASSERT_EQ(2,num_edges(g));
+    remove_edge(v[0],v[0],g);
+    ASSERT_EQ(1,num_edges(g));
+    undo_commit(g);
+    ASSERT_EQ(4,num_edges(g));
+}
+
+TEST(VersionedGraphTest, clearVertex) {
+    using namespace boost;
+    check_clear_vertex<versioned_graph<adjacency_list<vecS,vecS,undirectedS,int,int>>>();
+    check_clear_vertex<versioned_graph<adjacency_list<multisetS,listS,undirectedS,int,int>>>();
+    check_clear_vertex<versioned_graph<adjacency_list<listS,listS,bidirectionalS,int,int>>>();
+    check_clear_vertex<versioned_graph<adjacency_list<vecS,listS,directedS,int,int>>>();
+    check_clear_vertex<versioned_graph<intrusive_edge_history<adjacency_list<listS,vecS,undirectedS,int,int>>::type>>();
+}
+
+/**
+ * indexes of not deleted elements are permutation of 0..count-1
+ */
+template<typename graph>
+void check_compact_index(const graph& g){
+    using namespace boost;
+    std::vector<bool> seen(num_vertices(g),false);
+    auto vi = get(vertex_index,g);
+    for(auto it = vertices(g).first; it!=vertices(g).second; ++it){
+        ASSERT_LT(get(vi,*it),num_vertices(g));
+        ASSERT_FALSE(seen[get(vi,*it)]);
+        seen[get(vi,*it)] = true;
+    }
+    std::vector<bool> seen_edges(num_edges(g),false);
+    auto ei = get(edge_index,g);
+    for(auto it = edges(g).first; it!=edges(g).second; ++it){
+        ASSERT_LT(get(ei,*it),num_edges(g));
+        ASSERT_FALSE(seen_edges[get(ei,*it)]);
+        seen_edges[get(ei,*it)] = true;
+    }
+}
+
+TEST(VersionedGraphTest, compactIndex) {
+    using namespace boost;
+    struct Weight { int w; };
+    // BGL requires index properties declared in base graph, versioned graph replaces their values
+    typedef versioned_graph<adjacency_list<listS,listS,bidirectionalS,
+                                           property<vertex_index_t,std::size_t>,
+                                           property<edge_index_t,std::size_t,Weight>>> simple_graph;
+    static_assert(std::is_same<Weight,edge_bundle_type<simple_graph>::type>::value,"edge bundle stays the same");
+    typedef graph_traits<simple_graph>::vertex_descriptor vertex_descriptor;
+    simple_graph g;
+    std::vector<vertex_descriptor> v;
+    for(int i=0;i<6;++i){
+        v.push_back(add_vertex(g));
+    }
+    for(int i=0;i<5;++i){
+        add_edge(v[i],v[i+1],Weight{1},g);
+    }
+    add_edge(v[0],v[5],Weight{10},g);
+    commit(g);
+    ASSERT_NO_FATAL_FAILURE(check_compact_index(g));
+    clear_vertex(v[2],g);
+    remove_vertex(v[2],g);
+    auto extra = add_vertex(g);
+    add_edge(v[1],extra,Weight{1},g);
+    add_edge(extra,v[3],Weight{1},g);
+    ASSERT_NO_FATAL_FAILURE(check_compact_index(g));
+
+    // stock algorithms with maps indexed by vertex_index
+    std::vector<int> distance(num_vertices(g));
+    auto index = get(vertex_index,g);
+    dijkstra_shortest_paths(g,v[0],weight_map(get(&Weight::w,g)).
+                            distance_map(make_iterator_property_map(distance.begin(),index)));
+    ASSERT_EQ(5,distance[index[v[5]]]);
+    ASSERT_EQ(2,distance[index[extra]]);
+    std::vector<default_color_type> colors(num_vertices(g));
+    breadth_first_search(g,v[0],color_map(make_iterator_property_map(colors.begin(),index)));
+    ASSERT_EQ(black_color,colors[index[v[4]]]);
+
+    commit(g);
+    remove_edge(v[0],v[5],g);
+    ASSERT_NO_FATAL_FAILURE(check_compact_index(g));
+    undo_commit(g);
+    ASSERT_EQ(6,num_vertices(g));
+    ASSERT_NO_FATAL_FAILURE(check_compact_index(g));
+    simple_graph copy(g);
+    ASSERT_NO_FATAL_FAILURE(check_compact_index(copy));
+    dijkstra_shortest_paths(g,v[0],weight_map(get(&Weight::w,g)).
+                            distance_map(make_iterator_property_map(distance.begin(),get(vertex_index,g))));
+    ASSERT_EQ(5,distance[get(vertex_index,g,v[5])]);
+
+    typedef versioned_graph<intrusive_edge_history<adjacency_list<vecS,vecS,undirectedS,no_property,
+                                                                  property<edge_index_t,std::size_t,Weight>>>::type> intrusive_graph;
+    intrusive_graph ig(3);
+    auto loop = add_edge(0,0,Weight{1},ig).first;
+    add_edge(0,1,Weight{2},ig);
+    add_edge(1,2,Weight{3},ig);
+    commit(ig);
+    remove_edge(loop,ig);
+    ASSERT_EQ(2,ig[edge(0,1,ig).first].w);
+    ASSERT_NO_FATAL_FAILURE(check_compact_index(ig));
+    revert_changes(ig);
+    ASSERT_NO_FATAL_FAILURE(check_compact_index(ig));
+    ASSERT_EQ(3,num_edges(ig));
+}
+
+TEST(VersionedGraphTest, freezeSnapshot) {
+    using namespace boost;
+    struct City { int id; };
+    struct Road { int length; };
+    typedef versioned_graph<adjacency_list<listS,listS,bidirectionalS,City,Road>> road_graph;
+    road_graph g;
+    std::vector<graph_traits<road_graph>::vertex_descriptor> v;
+    for(int i=0;i<5;++i){
+        v.push_back(add_vertex(City{i},g));
+    }
+    for(int i=0;i<4;++i){
+        add_edge(v[i],v[i+1],Road{i+1},g);
+    }
+    auto shortcut = add_edge(v[0],v[4],Road{100},g).first;
+    commit(g);
+    remove_edge(shortcut,g);
+    clear_vertex(v[2],g);
+    remove_vertex(v[2],g);
+    add_edge(v[1],v[3],Road{7},g);
+
+    auto frozen = freeze(g);
+    const auto& csr = frozen.graph();
+    ASSERT_EQ(4,num_vertices(csr));
+    ASSERT_EQ(3,num_edges(csr));
+    for(auto it = vertices(csr).first; it!=vertices(csr).second; ++it){
+        ASSERT_EQ(g[frozen.original(*it)].id,csr[*it].id);
+        ASSERT_EQ(out_degree(frozen.original(*it),g),out_degree(*it,csr));
+        ASSERT_EQ(in_degree(frozen.original(*it),g),in_degree(*it,csr));
+    }
+    for(auto it = edges(csr).first; it!=edges(csr).second; ++it){
+        auto e = frozen.original(*it);
+        ASSERT_EQ(g[e].length,csr[*it].length);
+        ASSERT_EQ(frozen.original(source(*it,csr)),source(e,g));
+        ASSERT_EQ(frozen.original(target(*it,csr)),target(e,g));
+    }
+    std::vector<int> distance(num_vertices(csr));
+    dijkstra_shortest_paths(csr,vertex(g.get_index(v[0]),csr),weight_map(get(&Road::length,csr)).
+                            distance_map(make_iterator_property_map(distance.begin(),get(vertex_index,csr))));
+    ASSERT_EQ(12,distance[g.get_index(v[4])]);
+
+    // snapshot is not affected by later changes
+    revert_changes(g);
+    ASSERT_EQ(4,num_vertices(csr));
+
+    typedef versioned_graph<adjacency_list<vecS,vecS,undirectedS>> simple_graph;
+    simple_graph u(3);
+    add_edge(0,1,u);
+    add_edge(1,2,u);
+    auto frozen_u = freeze(u);
+    ASSERT_EQ(4,num_edges(frozen_u.graph()));
+    for(auto it = edges(frozen_u.graph()).first; it!=edges(frozen_u.graph()).second; ++it){
+        auto e = frozen_u.original(*it);
+        ASSERT_TRUE(source(*it,frozen_u.graph())==source(e,u) || source(*it,frozen_u.graph())==target(e,u));
+    }
+}
+
+TEST(VersionedGraphTest, asOfRevision) {
+    using namespace boost;
+    struct Name { int id; };
+    struct Budget { int total; };
+    struct Cost { int weight; };
+    typedef versioned_graph<adjacency_list<listS,listS,bidirectionalS,Name,Cost,Budget>> audit_graph;
+    typedef graph_traits<audit_graph>::vertex_descriptor vertex_descriptor;
+    audit_graph g;
+    g[graph_bundle].total = 10;
+    std::vector<vertex_descriptor> v;
+    for(int i=0;i<4;++i){
+        v.push_back(add_vertex(Name{i},g));
+    }
+    auto e01 = add_edge(v[0],v[1],Cost{1},g).first;
+    add_edge(v[1],v[2],Cost{2},g);
+    commit(g); // revision 1
+    g[e01].weight = 5;
+    g[v[0]].id = 100;
+    add_edge(v[2],v[3],Cost{3},g);
+    g[graph_bundle].total = 20;
+    commit(g); // revision 2
+    clear_vertex(v[1],g);
+    remove_vertex(v[1],g);
+    commit(g); // revision 3
+    add_vertex(Name{7},g); // uncommitted, invisible in every view
+
+    auto r1 = as_of(g,audit_graph::revision::create(1));
+    ASSERT_EQ(4,num_vertices(r1));
+    ASSERT_EQ(2,num_edges(r1));
+    ASSERT_EQ(0,r1[v[0]].id);
+    ASSERT_EQ(1,r1[e01].weight);
+    ASSERT_EQ(10,r1[graph_bundle].total);
+    ASSERT_EQ(1,out_degree(v[1],r1));
+    ASSERT_EQ(v[2],*adjacent_vertices(v[1],r1).first);
+
+    auto r2 = as_of(g,audit_graph::revision::create(2));
+    ASSERT_EQ(3,num_edges(r2));
+    ASSERT_EQ(100,r2[v[0]].id);
+    ASSERT_EQ(5,r2[e01].weight);
+    ASSERT_EQ(20,r2[graph_bundle].total);
+
+    auto r3 = as_of(g,audit_graph::revision::create(3));
+    ASSERT_EQ(3,num_vertices(r3));
+    ASSERT_EQ(1,num_edges(r3));
+    ASSERT_EQ(0,out_degree(v[0],r3));
+    for(auto it = vertices(r3).first; it!=vertices(r3).second; ++it){
+        ASSERT_NE(v[1],*it);
+    }
+
+    // stock algorithm on past revision, graph itself stays untouched
+    std::map<vertex_descriptor,default_color_type> colors;
+    std::map<vertex_descriptor,int> order;
+    int visited = 0;
+    struct recorder : public default_bfs_visitor {
+        std::map<vertex_descriptor,int>* order;
+        int* visited;
+        void discover_vertex(vertex_descriptor u, const revision_view<audit_graph::graph_type>&){
+            (*order)[u] = (*visited)++;
+        }
+    } vis;
+    vis.order = &order;
+    vis.visited = &visited;
+    breadth_first_search(r2,v[0],visitor(vis).color_map(make_assoc_property_map(colors)));
+    ASSERT_EQ(4,visited);
+    ASSERT_EQ(3,order[v[3]]);
+    ASSERT_EQ(4,num_vertices(g));
+    ASSERT_EQ(1,num_edges(g));
+
+    typedef versioned_graph<adjacency_list<vecS,vecS,undirectedS>> simple_graph;
+    simple_graph sg(3);
+    auto e = add_edge(0,1,sg).first;
+    commit(sg);
+    remove_edge(e,sg);
+    add_edge(1,2,sg);
+    commit(sg);
+    auto old = as_of(sg,simple_graph::revision::create(1));
+    ASSERT_EQ(1,num_edges(old));
+    ASSERT_EQ(1,out_degree(0,old));
+    ASSERT_EQ(0,out_degree(2,old));
+}
+
+TEST(VersionedGraphTest, historyLookup) {
+    using namespace boost::detail;
+    split_history<revision,int> hist;
+    hist.push(std::make_pair(revision::create(1),10));
+    hist.push(std::make_pair(revision::create(3),30));
+    hist.push(std::make_pair(revision::create(4),40));
+    hist.push(std::make_pair(revision::create(6).create_deleted(),0));
+    ASSERT_EQ(10,find_record(hist,revision::create(2))->second);
+    ASSERT_EQ(30,find_record(hist,revision::create(3))->second);
+    ASSERT_EQ(40,find_record(hist,revision::create(5))->second);
+    ASSERT_TRUE(existed_in(hist,revision::create(5)));
+    ASSERT_FALSE(existed_in(hist,revision::create(7)));
+    auto range = records_between(hist,revision::create(2),revision::create(4));
+    ASSERT_EQ(2,range.second-range.first);
+    ASSERT_EQ(30,range.first->second);
+
+    // value of vertex in every revision of long history
+    typedef versioned_graph<adjacency_list<vecS,vecS,directedS,int>> simple_graph;
+    simple_graph g(1);
+    for(int r=1;r<=1000;++r){
+        g[0] = r*r;
+        commit(g);
+    }
+    for(int r=1;r<=1000;r+=37){
+        ASSERT_EQ(r*r,as_of(g,simple_graph::revision::create(r))[0]);
+    }
+    const simple_graph& cg = g;
+    ASSERT_EQ(1000,cg.get_history(0).size());
+}
+
+TEST(VersionedGraphTest, revisionDiff) {
+    using namespace boost;
+    typedef versioned_graph<adjacency_list<vecS,vecS,undirectedS,int,int,int>> simple_graph;
+    typedef simple_graph::revision revision;
+    simple_graph g(4);
+    for(int i=0;i<4;++i){
+        g[i] = 0;
+    }
+    auto e01 = add_edge(0,1,1,g).first;
+    auto e12 = add_edge(1,2,2,g).first;
+    commit(g); // revision 1
+    g[0] = 5;
+    g[e01] = 10;
+    auto e23 = add_edge(2,3,3,g).first;
+    commit(g); // revision 2
+    remove_edge(e12,g);
+    g[0] = 0; // back to value of revision 1
+    g[graph_bundle] = 7;
+    auto e03 = add_edge(0,3,4,g).first;
+    commit(g); // revision 3
+    remove_edge(e03,g);
+    commit(g); // revision 4
+
+    auto d = diff(g,revision::create(1),revision::create(2));
+    ASSERT_EQ(std::vector<graph_traits<simple_graph>::vertex_descriptor>{0},d.modified.vertices);
+    ASSERT_EQ(1,d.modified.edges.size());
+    ASSERT_EQ(g.get_edge_key(e01),g.get_edge_key(d.modified.edges[0]));
+    ASSERT_EQ(1,d.added.edges.size());
+    ASSERT_EQ(g.get_edge_key(e23),g.get_edge_key(d.added.edges[0]));
+    ASSERT_TRUE(d.removed.edges.empty());
+    ASSERT_FALSE(d.graph_bundle_modified);
+
+    d = diff(g,revision::create(1),revision::create(4));
+    ASSERT_TRUE(d.modified.vertices.empty()); // modified and restored
+    ASSERT_EQ(1,d.added.edges.size()); // e03 was created and removed in range
+    ASSERT_EQ(1,d.removed.edges.size());
+    ASSERT_EQ(g.get_edge_key(e12),g.get_edge_key(d.removed.edges[0]));
+    ASSERT_EQ(2,as_of(g,revision::create(1))[d.removed.edges[0]]);
+    ASSERT_TRUE(d.graph_bundle_modified);
+
+    d = diff(g,revision::create(3),revision::create(4));
+    ASSERT_EQ(1,d.removed.edges.size());
+    ASSERT_TRUE(d.added.edges.empty());
+
+    // everything from empty graph
+    d = diff(g,revision::create(0),revision::create(4));
+    ASSERT_EQ(4,d.added.vertices.size());
+    ASSERT_EQ(2,d.added.edges.size());
+    ASSERT_TRUE(d.removed.edges.empty());
+    ASSERT_TRUE(diff(g,revision::create(2),revision::create(2)).added.vertices.empty());
+}
+
+template<typename graph>
+struct batch_recorder : public graph::observer_type {
+    std::vector<typename graph::change_batch_type> batches;
+    void on_changes(const typename graph::change_batch_type& batch){
+        batches.push_back(batch);
+    }
+};
+
+TEST(VersionedGraphTest, changeObserver) {
+    using namespace boost;
+    typedef versioned_graph<adjacency_list<listS,listS,bidirectionalS,int,int>> simple_graph;
+    typedef simple_graph::change_batch_type batch_type;
+    simple_graph g;
+    batch_recorder<simple_graph> recorder;
+    add_observer(g,&recorder);
+    auto u = add_vertex(1,g);
+    auto v = add_vertex(2,g);
+    auto e = add_edge(u,v,3,g).first;
+    ASSERT_TRUE(recorder.batches.empty()); // nothing delivered per mutation
+    commit(g);
+    ASSERT_EQ(1,recorder.batches.size());
+    ASSERT_EQ(batch_type::commit_operation,recorder.batches[0].operation);
+    ASSERT_EQ(simple_graph::revision::create(1),recorder.batches[0].rev);
+    ASSERT_EQ(2,recorder.batches[0].added.vertices.size());
+    ASSERT_EQ(1,recorder.batches[0].added.edges.size());
+
+    g[u] = 10;
+    remove_edge(e,g);
+    commit(g);
+    const batch_type& second = recorder.batches[1];
+    ASSERT_EQ(std::vector<graph_traits<simple_graph>::vertex_descriptor>{u},second.modified.vertices);
+    ASSERT_EQ(1,second.removed.edges.size());
+
+    g[v] = 20;
+    revert_changes(g);
+    ASSERT_EQ(3,recorder.batches.size());
+    ASSERT_EQ(batch_type::revert_operation,recorder.batches[2].operation);
+    ASSERT_TRUE(recorder.batches[2].modified.vertices.empty());
+
+    undo_commit(g);
+    ASSERT_EQ(4,recorder.batches.size());
+    const batch_type& undo = recorder.batches[3];
+    ASSERT_EQ(batch_type::undo_operation,undo.operation);
+    ASSERT_EQ(simple_graph::revision::create(1),undo.rev);
+    ASSERT_EQ(1,undo.resurrected.edges.size());
+    ASSERT_EQ(std::vector<graph_traits<simple_graph>::vertex_descriptor>{u},undo.modified.vertices);
+    ASSERT_EQ(1,num_edges(g));
+
+    remove_observer(g,&recorder);
+    commit(g);
+    ASSERT_EQ(4,recorder.batches.size());
+}
+
+TEST(VersionedGraphTest, nonConstRead) {
+    using namespace boost;
+    typedef versioned_graph<adjacency_list<boost::vecS, boost::vecS, boost::bidirectionalS,int,int,long>> simple_graph;
+    typedef simple_graph::revision revision;
+    simple_graph sg;
+    auto v1 = add_vertex(1,sg);
+    auto v2 = add_vertex(2,sg);
+    auto e = add_edge(v1,v2,12,sg).first;
+    sg[graph_bundle] = 3;
+    commit(sg);
+    batch_recorder<simple_graph> recorder;
+    add_observer(sg,&recorder);
+    long sum = 0;
+    for(int step=0;step<5;++step){
+        sum += sg[v1]+sg[e]+sg[graph_bundle]; // marks elements, values are compared at commit
+        commit(sg);
+    }
+    ASSERT_EQ(5*16,sum);
+    const simple_graph& csg = sg;
+    ASSERT_EQ(1,csg.get_history(v1).size());
+    ASSERT_EQ(1,csg.get_history(e).size());
+    auto d = diff(sg,revision::create(1),revision::create(6));
+    ASSERT_TRUE(d.modified.vertices.empty());
+    ASSERT_TRUE(d.modified.edges.empty());
+    ASSERT_FALSE(d.graph_bundle_modified);
+    ASSERT_EQ(5,recorder.batches.size());
+    for(const auto& batch : recorder.batches){
+        ASSERT_TRUE(batch.modified.vertices.empty());
+        ASSERT_TRUE(batch.modified.edges.empty());
+    }
+    remove_observer(sg,&recorder);
+}
+
+/**
+ * observer removing itself and adding recorder when notified
+ */
+template<typename graph>
+struct handing_over_observer : public graph::observer_type {
+    graph* g;
+    typename graph::observer_type* next;
+    int calls;
+    handing_over_observer(graph* g, typename graph::observer_type* next) : g(g),next(next),calls(0) {}
+    void on_changes(const typename graph::change_batch_type&){
+        ++calls;
+        remove_observer(*g,this);
+        add_observer(*g,next);
+    }
+};
+
+TEST(VersionedGraphTest, observerChangesObservers) {
+    using namespace boost;
+    typedef versioned_graph<adjacency_list<vecS,vecS,undirectedS,int,int>> simple_graph;
+    static_assert(!std::is_copy_assignable<simple_graph>::value,"observers are not copied with graph");
+    simple_graph g;
+    batch_recorder<simple_graph> recorder;
+    handing_over_observer<simple_graph> first(&g,&recorder);
+    add_observer(g,&first);
+    add_vertex(1,g);
+    commit(g);
+    ASSERT_EQ(1,first.calls);
+    ASSERT_TRUE(recorder.batches.empty()); // added during notification, called from next batch
+    add_vertex(2,g);
+    commit(g);
+    ASSERT_EQ(1,first.calls);
+    ASSERT_EQ(1,recorder.batches.size());
+    ASSERT_EQ(1,recorder.batches[0].added.vertices.size());
+}
+
+TEST(VersionedGraphTest, blockPool) {
+    using namespace boost::detail;
+    void* a = block_pool::allocate(40);
+    void* b = block_pool::allocate(48);
+    ASSERT_NE(a,b);
+    block_pool::deallocate(a,40);
+    ASSERT_EQ(a,block_pool::allocate(33)); // the same size class is reused
+    void* large = block_pool::allocate(block_pool::max_block_size+1);
+    block_pool::deallocate(large,block_pool::max_block_size+1);
+
+    // block freed by other thread, lists of finished thread are reused
+    void* c = nullptr;
+    std::thread([&](){ c = block_pool::allocate(64); }).join();
+    block_pool::deallocate(c,64);
+    std::thread([&](){
+        void* d = block_pool::allocate(16);
+        block_pool::deallocate(d,16);
+        block_pool::deallocate(a,40);
+        block_pool::deallocate(b,48);
+    }).join();
+
+    // rest of chunk too small for a request is kept as free block
+    std::thread([&](){
+        const std::size_t size = 4000;
+        const std::size_t per_chunk = block_pool::chunk_size/size;
+        std::vector<char*> blocks;
+        for(std::size_t i=0;i<=per_chunk;++i){
+            blocks.push_back(static_cast<char*>(block_pool::allocate(size)));
+        }
+        const std::size_t rest = block_pool::chunk_size-per_chunk*size;
+        ASSERT_EQ(blocks[0]+per_chunk*size,block_pool::allocate(rest));
+    }).join();
+
+    // blocks freed by consumer thread are reused by producer thread
+    const std::size_t count = block_pool::max_cached_bytes/256+1;
+    std::vector<void*> produced(count);
+    std::thread([&](){
+        for(auto& p : produced){
+            p = block_pool::allocate(256);
+        }
+    }).join();
+    for(auto p : produced){
+        block_pool::deallocate(p,256);
+    }
+    void* reused = nullptr;
+    std::thread([&](){ reused = block_pool::allocate(256); }).join();
+    ASSERT_NE(produced.end(),std::find(produced.begin(),produced.end(),reused));
+
+    typedef boost::versioned_graph<boost::adjacency_list<boost::listS,boost::listS,boost::undirectedS,int,int>,
+                                   pool_allocator<char> > pool_graph;
+    pool_graph g;
+    auto u = add_vertex(1,g);
+    auto v = add_vertex(2,g);
+    add_edge(u,v,3,g);
+    for(int r=0;r<4;++r){
+        g[u] = r;
+        commit(g);
+    }
+    undo_commit(g);
+    ASSERT_EQ(2,g[u]);
+    ASSERT_EQ(1,as_of(g,pool_graph::revision::create(2))[u]);
+
+    split_history<revision,int,2,pool_allocator<char> > hist;
+    for(int r=1;r<=100;++r){
+        hist.push(std::make_pair(revision::create(r),r));
+    }
+    ASSERT_EQ(50,find_record(hist,revision::create(50))->second);
+    hist.clear();
+    ASSERT_EQ(0,hist.heap_bytes());
+}
+
+namespace {
+
+std::size_t counted_bytes = 0;
+
+/**
+ * stateless allocator counting live bytes of all its rebinds
+ */
+template<typename T>
+struct counting_allocator {
+    typedef T value_type;
+    counting_allocator() {}
+    template<typename U>
+    counting_allocator(const counting_allocator<U>&) {}
+    T* allocate(std::size_t n){
+        counted_bytes += n*sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* p, std::size_t n){
+        counted_bytes -= n*sizeof(T);
+        std::allocator<T>().deallocate(p,n);
+    }
+};
+template<typename T, typename U>
+bool operator==(const counting_allocator<T>&, const counting_allocator<U>&){ return true; }
+template<typename T, typename U>
+bool operator!=(const counting_allocator<T>&, const counting_allocator<U>&){ return false; }
+
+template<typename graph>
+void check_allocator(){
+    using namespace boost;
+    {
+        graph g;
+        std::vector<typename graph_traits<graph>::vertex_descriptor> vs;
+        for(int i=0;i<20;++i){
+            vs.push_back(add_vertex(i,g));
+        }
+        for(int i=1;i<20;++i){
+            add_edge(vs[i-1],vs[i],i,g);
+        }
+        commit(g);
+        ASSERT_LT(0,counted_bytes);
+        for(int r=0;r<3;++r){
+            for(auto v : vs){
+                g[v] += 1;
+            }
+            commit(g);
+        }
+        graph copy(g);
+        undo_commit(copy);
+        ASSERT_EQ(19,num_edges(copy));
+        ASSERT_EQ(2,copy[*vertices(copy).first]);
+        ASSERT_EQ(3,g[vs[0]]);
+        ASSERT_EQ(1,as_of(g,graph::revision::create(2))[vs[0]]);
+    }
+    ASSERT_EQ(0,counted_bytes);
+}
+
+}
+
+TEST(VersionedGraphTest, customAllocator) {
+    using namespace boost;
+    static_assert(std::is_same<versioned_graph<adjacency_list<>>::allocator_type,std::allocator<char> >::value,
+                  "block pool is opt-in");
+    check_allocator<versioned_graph<adjacency_list<vecS,vecS,bidirectionalS,int,int>,counting_allocator<char>>>();
+    check_allocator<versioned_graph<adjacency_list<listS,listS,undirectedS,int,int>,counting_allocator<char>>>();
+    check_allocator<versioned_graph<intrusive_edge_history<adjacency_list<listS,vecS,directedS,int,int>,counting_allocator<char>>::type,
+                                    counting_allocator<char>>>();
+}
+
+TEST(VersionedGraphTest, revisionEncoding) {
+    using namespace boost::detail;
+    static_assert(sizeof(revision)==sizeof(revision_word),"revision is single word");
+    revision r = revision::create(5);
+    revision d = r.create_deleted();
+    ASSERT_TRUE(is_deleted(d));
+    ASSERT_FALSE(is_deleted(r));
+    ASSERT_EQ(r,d); // deleted flag does not take part in ordering
+    ASSERT_TRUE(revision::create(4)<d);
+    ASSERT_TRUE(d<revision::create(6));
+    ASSERT_EQ(5,d.get_rev());
+    revision last = revision::create_max();
+    ASSERT_FALSE(is_deleted(last));
+    ASSERT_TRUE(is_deleted(last.create_deleted()));
+    ASSERT_EQ(last,last.create_deleted());
+    ASSERT_TRUE(revision::create(last.get_rev()-1)<last);
+    ASSERT_EQ(revision_word(-1)>>1,last.get_rev());
+}
+
+TEST(VersionedGraphTest, splitHistory) {
+    using namespace boost::detail;
+    typedef split_history<revision,double> history_type;
+    static_assert(sizeof(history_type)<sizeof(void*)+2*sizeof(std::uint32_t)+2*sizeof(std::pair<revision,double>),
+                  "revisions are not padded to alignment of bundle");
+    static_assert(std::is_nothrow_move_constructible<history_type>::value &&
+                  std::is_nothrow_move_assignable<history_type>::value,
+                  "vector of histories moves them on reallocation");
+    static_assert(std::is_nothrow_move_constructible<
+                      vertex_data<split_history<revision,std::string>,std::size_t,bidirectional_tag> >::value,
+                  "vertex storage moves histories on reallocation");
+    history_type hist;
+    for(int r=1;r<=5;++r){
+        hist.push(std::make_pair(revision::create(r),r*1.5));
+    }
+    ASSERT_EQ(5,hist.size());
+    ASSERT_LT(0,hist.heap_bytes());
+    ASSERT_EQ(revision::create(5),hist.top().first);
+    hist.top() = std::make_pair(revision::create(5).create_deleted(),0.0);
+    ASSERT_TRUE(is_deleted(get_revision(hist.top())));
+    ASSERT_EQ(3.0,find_record(hist,revision::create(2))->second);
+    ASSERT_FALSE(find_record(hist,revision::create(0)));
+    ASSERT_TRUE(existed_in(hist,revision::create(4)));
+    ASSERT_FALSE(existed_in(hist,revision::create(6)));
+    auto range = records_between(hist,revision::create(2),revision::create(3));
+    ASSERT_EQ(2,range.second-range.first);
+
+    history_type copy(hist);
+    hist.pop();
+    hist.push(hist.top()); // record of the same history
+    ASSERT_EQ(revision::create(4),get_revision(hist.top()));
+    ASSERT_EQ(6.0,get_value(hist[4]));
+    history_type moved(std::move(copy));
+    ASSERT_TRUE(copy.empty());
+    ASSERT_EQ(5,moved.size());
+    ASSERT_EQ(7.5,moved[3].second+1.5);
+    moved.clear();
+    ASSERT_EQ(0,moved.heap_bytes());
+
+    history_type small;
+    small.push(std::make_pair(revision::create(1),1.0));
+    history_type other(std::move(small)); // inline records are moved one by one
+    ASSERT_EQ(1.0,other.top().second);
+    other = hist;
+    ASSERT_EQ(5,other.size());
+    moved = std::move(other);
+    ASSERT_EQ(5,moved.size());
+    ASSERT_EQ(6.0,moved.top().second);
+}
+
+TEST(VersionedGraphTest, existenceHistory) {
+    using namespace boost::detail;
+    static_assert(sizeof(existence_history)==2*sizeof(revision),"two revisions per element");
+    existence_history hist;
+    ASSERT_TRUE(hist.empty());
+    hist.push(revision::create(3));
+    ASSERT_EQ(1,hist.size());
+    ASSERT_FALSE(existed_in(hist,revision::create(2)));
+    ASSERT_EQ(nullptr,find_record(hist,revision::create(2)));
+    ASSERT_TRUE(existed_in(hist,revision::create(3)));
+    hist.push(revision::create(5).create_deleted());
+    ASSERT_TRUE(is_deleted(hist.top()));
+    ASSERT_TRUE(existed_in(hist,revision::create(4)));
+    ASSERT_FALSE(existed_in(hist,revision::create(5)));
+    hist.pop();
+    ASSERT_TRUE(existed_in(hist,revision::create(9)));
+    hist.top() = revision::create(4);
+    ASSERT_FALSE(existed_in(hist,revision::create(3)));
+
+    // structural graph, history of elements is kept inside their stored data
+    typedef versioned_graph<adjacency_list<vecS,listS,bidirectionalS>> simple_graph;
+    simple_graph g;
+    auto u = add_vertex(g);
+    auto v = add_vertex(g);
+    auto e = add_edge(u,v,g).first;
+    commit(g);
+    remove_edge(e,g);
+    auto w = add_vertex(g);
+    commit(g);
+    remove_vertex(w,g);
+    commit(g);
+    ASSERT_EQ(0,num_edges(g));
+    ASSERT_EQ(1,num_edges(as_of(g,simple_graph::revision::create(1))));
+    ASSERT_EQ(3,num_vertices(as_of(g,simple_graph::revision::create(2))));
+    ASSERT_EQ(2,num_vertices(g));
+    undo_commit(g);
+    undo_commit(g);
+    ASSERT_EQ(1,num_edges(g));
+    ASSERT_EQ(2,num_vertices(g));
+    const simple_graph& cg = g;
+    ASSERT_EQ(1,cg.get_history(u).size());
+}
+
+namespace {
+
+int document_copies = 0;
+
+struct Document {
+    std::vector<int> words;
+    Document() {}
+    explicit Document(int n) : words(n,n) {}
+    Document(const Document& other) : words(other.words){
+        ++document_copies;
+    }
+    Document(Document&&) = default;
+    bool operator!=(const Document& other) const{
+        return words!=other.words;
+    }
+};
+
+}
+
+TEST(VersionedGraphTest, sharedBundle) {
+    using namespace boost;
+    typedef versioned_graph<adjacency_list<vecS,vecS,bidirectionalS,shared_bundle<Document>,no_property,
+                                           shared_bundle<std::string>>> doc_graph;
+    doc_graph g;
+    auto u = add_vertex(Document(100),g);
+    auto v = add_vertex(g);
+    add_edge(u,v,g);
+    g[graph_bundle] = std::string(1000,'a');
+    document_copies = 0;
+    commit(g);
+    for(int r=0;r<5;++r){
+        g[u].modify().words.push_back(r);
+        commit(g);
+    }
+    ASSERT_EQ(5,document_copies); // only writes to values already in history copy them
+    ASSERT_EQ(105,g[u]->words.size());
+    ASSERT_EQ(0,g[v]->words.size());
+
+    document_copies = 0;
+    doc_graph copy(g);
+    undo_commit(g);
+    undo_commit(g);
+    ASSERT_EQ(103,g[u]->words.size());
+    ASSERT_EQ(100,as_of(copy,doc_graph::revision::create(1))[u]->words.size());
+    g[v] = Document(3);
+    commit(g);
+    ASSERT_EQ(0,document_copies);
+    ASSERT_TRUE(copy[u].shares(as_of(copy,doc_graph::revision::create(6))[u]));
+    ASSERT_EQ(1000,g[graph_bundle]->size());
+
+    // equal values are not recorded again
+    const doc_graph& cg = g;
+    const auto recorded = cg.get_history(u).size();
+    g[u] = Document(g[u].get());
+    commit(g);
+    ASSERT_EQ(recorded,cg.get_history(u).size());
+}
+
+TEST(VersionedGraphTest, diffAfterEraseHistory) {
+    using namespace boost;
+    typedef versioned_graph<adjacency_list<listS,listS,bidirectionalS,int,int>> simple_graph;
+    typedef simple_graph::revision revision;
+    simple_graph g;
+    auto u = add_vertex(1,g);
+    auto v = add_vertex(2,g);
+    auto w = add_vertex(3,g);
+    add_edge(u,v,4,g);
+    auto e = add_edge(v,w,5,g).first;
+    commit(g);
+    remove_edge(e,g);
+    commit(g);
+    erase_history(g);
+    batch_recorder<simple_graph> recorder;
+    add_observer(g,&recorder);
+    commit(g);
+    auto d = diff(g,revision::create(0),revision::create(1));
+    ASSERT_EQ(3,d.added.vertices.size());
+    ASSERT_EQ(1,d.added.edges.size());
+    ASSERT_EQ(num_vertices(as_of(g,revision::create(1))),d.added.vertices.size());
+    ASSERT_EQ(1,recorder.batches.size());
+    ASSERT_EQ(3,recorder.batches[0].added.vertices.size());
+    ASSERT_EQ(1,recorder.batches[0].added.edges.size());
+    g[u] = 10;
+    commit(g);
+    ASSERT_EQ(std::vector<graph_traits<simple_graph>::vertex_descriptor>{u},
+              diff(g,revision::create(1),revision::create(2)).modified.vertices);
+}
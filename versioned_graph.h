@@ -9,128 +9,290 @@
 #include <boost/graph/adjacency_matrix.hpp>
 #include <boost/graph/graph_utility.hpp>
 #include <boost/iterator/filter_iterator.hpp>
+#include <boost/type_traits/has_not_equal_to.hpp>
+#include <algorithm>
+#include <cstdint>
 #include <stack>
+#include <stdexcept>
 #include <unordered_map>
 #include <type_traits>
+#include <vector>
+#include "versioned_graph_bitset.h"
+#include "versioned_graph_history.h"
+#include "versioned_graph_pool.h"
 
 
 namespace boost {
 
+/**
+ * tag of edge property holding history record, see intrusive_edge_history
+ */
+enum edge_history_t { edge_history };
+BOOST_INSTALL_PROPERTY(edge, history);
+
 namespace detail {
 
+#ifdef VERSIONED_GRAPH_WIDE_REVISION
+typedef std::uint64_t revision_word;
+#else
+typedef std::uint32_t revision_word;
+#endif
+
+/**
+ *  number of revision packed with deleted flag in the lowest bit of single word,
+ *  revisions are ordered by number only. Revision word has 32 bits, 64 bits when
+ *  VERSIONED_GRAPH_WIDE_REVISION is defined, numbers above create_max() are not representable,
+ *  see revision_overflow
+ */
 class revision{
-    int rev;
-    revision(int r) : rev(r){ }
+    revision_word bits;
+    explicit revision(revision_word bits) : bits(bits){ }
+    revision_word number() const{
+        return bits>>1;
+    }
 public:
     bool operator<(const revision& r) const{
-        return abs(rev) < abs(r.rev);
+        return number() < r.number();
     }
     bool operator>(const revision& r) const{
-        return abs(rev) > abs(r.rev);
+        return number() > r.number();
     }
     bool operator<=(const revision& r) const{
-        return abs(rev) <= abs(r.rev);
+        return number() <= r.number();
     }
     bool operator>=(const revision& r) const{
-        return abs(rev) >= abs(r.rev);
+        return number() >= r.number();
     }
     bool operator==(const revision& r) const{
-        return abs(rev) == abs(r.rev);
+        return number() == r.number();
     }
     bool is_older(const revision& r)const{
         return *this < r;
     }
     revision& operator++(){
-        assert(rev >=0);
-        ++rev;
+        assert(!deleted() && *this<create_max());
+        bits += 2;
         return *this;
     }
     revision& operator--(){
-        assert(rev >0);
-        --rev;
+        assert(!deleted() && number()>0);
+        bits -= 2;
         return *this;
     }
 
-//    operator int()
-//    {
-//         return rev;
-//    }
-    int get_rev() const {
-        return rev;
+    revision_word get_rev() const {
+        return number();
+    }
+    bool deleted() const{
+        return bits&1;
     }
     static revision create_start(){
-        return revision(1);
+        return create(1);
     }
     static revision create_max(){
-        return revision(std::numeric_limits<int>::max());
+        return revision(~revision_word(0)-1);
     }
-    static revision create(int value){
-        return revision(value);
+    static revision create(revision_word value){
+        assert(value<=create_max().number());
+        return revision(value<<1);
     }
     revision create_deleted() const{
-        revision rev = *this;
-        rev.rev = -rev.rev;
-        return rev;
+        return revision(bits|1);
     }
 
 };
 
 bool is_deleted(const revision& rev){
-    return rev.get_rev()<0;
+    return rev.deleted();
 }
 std::ostream& operator<<(std::ostream& os, const revision& obj) {
-    return os << obj.get_rev() << " ";
+    return os << (obj.deleted() ? "-" : "") << obj.get_rev() << " ";
 }
 
 /**
- *  Type used for history of vertex and edge bundled properties
+ *  thrown by commit() when revision number would exceed revision::create_max(),
+ *  graph is left unchanged, erase_history() restarts numbering from revision::create_start()
  */
-template<class T>
+class revision_overflow : public std::overflow_error {
+public:
+    revision_overflow() : std::overflow_error("versioned_graph: revision number overflow") {}
+};
+
+/**
+ *  History of element without bundled property, it is only the interval [born, died)
+ *  of revisions in which element exists. Element is created once and deleted at most once,
+ *  undo and revert remove records instead of adding them, so two revision words
+ *  are enough and nothing is allocated. Unused record holds revision 0.
+ *  Provides history interface of split_history, records are born and died revision.
+ */
+class existence_history {
+public:
+    typedef revision value_type;
+    typedef std::uint32_t size_type;
+    typedef revision& reference;
+    typedef const revision& const_reference;
+    typedef revision* iterator;
+    typedef const revision* const_iterator;
+    typedef const revision* const_pointer;
+
+    existence_history() : records{revision::create(0),revision::create(0)} {}
+
+    void push(const revision& r){
+        BOOST_ASSERT_MSG(!(records[1]>revision::create(0)),"Element deleted twice");
+        records[size()] = r;
+    }
+    void pop(){
+        BOOST_ASSERT(!empty());
+        records[size()-1] = revision::create(0);
+    }
+
+    /**
+     * latest record, died revision of deleted element
+     */
+    reference top(){
+        BOOST_ASSERT(!empty());
+        return records[size()-1];
+    }
+    const_reference top() const{
+        BOOST_ASSERT(!empty());
+        return records[size()-1];
+    }
+
+    reference operator[](size_type i){
+        BOOST_ASSERT(i<size());
+        return records[i];
+    }
+    const_reference operator[](size_type i) const{
+        BOOST_ASSERT(i<size());
+        return records[i];
+    }
+
+    iterator begin(){ return records; }
+    iterator end(){ return records+size(); }
+    const_iterator begin() const{ return records; }
+    const_iterator end() const{ return records+size(); }
+
+    size_type size() const{
+        return (records[0]>revision::create(0)) + (records[1]>revision::create(0));
+    }
+    bool empty() const{
+        return !(records[0]>revision::create(0));
+    }
+    void clear(){
+        records[0] = records[1] = revision::create(0);
+    }
+    void reserve(size_type n){
+        BOOST_ASSERT(n<=2);
+    }
+    std::size_t heap_bytes() const{
+        return 0;
+    }
+private:
+    revision records[2];
+};
+
+/**
+ *  default allocator of versioned_graph, pool_allocator<char> is opt-in, see block_pool
+ */
+typedef std::allocator<char> default_allocator;
+
+/**
+ *  allocator_t rebound to value type T, every container of versioned_graph uses allocator of graph
+ */
+template<typename allocator_t, typename T>
+struct rebind_allocator{
+    typedef typename std::allocator_traits<allocator_t>::template rebind_alloc<T> type;
+};
+
+/**
+ *  Type used for history of vertex and edge bundled properties,
+ *  revisions and bundles are kept in separate arrays
+ */
+template<class T, typename allocator_t>
 struct property_records{
-    typedef std::stack<std::pair<revision,T> > type;
+    typedef split_history<revision,T,2,allocator_t> type;
 };
 
 /**
  *  Type used for history of vertex and edge without bundled properties
  */
-template<>
-struct property_records<boost::no_property>{
-    typedef std::stack<revision> type;
+template<typename allocator_t>
+struct property_records<boost::no_property,allocator_t>{
+    typedef existence_history type;
 };
 
+/**
+ *  compares bundled values using operator!= if type provides it,
+ *  otherwise every written value is treated as changed
+ */
+template<typename T>
+bool values_differ(const T& a, const T& b, std::true_type){
+    return a!=b;
+}
+template<typename T>
+bool values_differ(const T& , const T& , std::false_type){
+    return true;
+}
+template<typename T>
+bool values_differ(const T& a, const T& b){
+    return values_differ(a,b,std::integral_constant<bool,boost::has_not_equal_to<T>::value>());
+}
+
 /**
  *  Type used for history of graph bundled properties
  */
-template<class T>
+template<class T, typename allocator_t>
 class property_optional_records{
-    typedef std::stack<std::pair<revision,T> > history_type;
+    typedef std::vector<std::pair<revision,T>,typename rebind_allocator<allocator_t,std::pair<revision,T> >::type> history_type;
     history_type hist;
 public:
     void update_if_needed(revision rev,const T& value){
         if(hist.empty()){
-            hist.push(std::make_pair(rev,value));
+            hist.push_back(std::make_pair(rev,value));
         } else {
-            auto p = hist.top();
+            const auto& p = hist.back();
             assert(p.first<rev);
-            if(p.second!=value)
+            if(values_differ(p.second,value))
             {
-                hist.push(std::make_pair(rev,value));
+                hist.push_back(std::make_pair(rev,value));
             }
         }
     }
     void clean_to_max(const revision& rev){
-        while(!hist.empty() && hist.top().first>=rev){
-            hist.pop();
+        while(!hist.empty() && hist.back().first>=rev){
+            hist.pop_back();
         }
     }
     void clear(){
-        while(!hist.empty()){
-            hist.pop();
-        }
+        hist.clear();
     }
     const T& get_latest() const{
         BOOST_ASSERT_MSG(!hist.empty(),"Trying to obtain graph bundle from empty history");
-        return hist.top().second;
+        return hist.back().second;
+    }
+    /**
+     * checks if value committed in revision to differs from value committed in revision from
+     */
+    bool changed_between(const revision& from, const revision& to) const{
+        auto less = [](const revision& r, const std::pair<revision,T>& p){ return r<p.first; };
+        auto first = std::upper_bound(hist.begin(),hist.end(),from,less);
+        auto last = std::upper_bound(hist.begin(),hist.end(),to,less);
+        if(first==last){
+            return false;
+        }
+        return first==hist.begin() || values_differ((first-1)->second,(last-1)->second);
+    }
+    /**
+     * value committed in revision rev or in the latest older revision
+     */
+    const T& get_at(const revision& rev) const{
+        auto it = std::upper_bound(hist.begin(),hist.end(),rev,
+                                   [](const revision& r, const std::pair<revision,T>& p){ return r<p.first; });
+        BOOST_ASSERT_MSG(it!=hist.begin(),"Trying to obtain graph bundle older than history");
+        return (it-1)->second;
+    }
+    bool empty() const{
+        return hist.empty();
     }
 
 };
@@ -138,14 +300,23 @@ public:
 /**
  *  Type used for history when there is no graph bundled properties
  */
-template<>
-struct property_optional_records<boost::no_property>{
+template<typename allocator_t>
+struct property_optional_records<boost::no_property,allocator_t>{
     void update_if_needed(revision ,const boost::no_property& ){}
     void clean_to_max(const revision& ){}
     void clear(){}
     boost::no_property get_latest() const{
         return boost::no_property();
     }
+    boost::no_property get_at(const revision& ) const{
+        return boost::no_property();
+    }
+    bool changed_between(const revision& , const revision& ) const{
+        return false;
+    }
+    bool empty() const{
+        return false;
+    }
 };
 
 template<typename property_type>
@@ -164,30 +335,283 @@ revision get_revision(const std::pair<revision,property_type>& value){
 revision get_revision(const revision& value){
     return value;
 }
+template<typename key_type, typename property_type>
+revision get_revision(const split_record<key_type,property_type>& value){
+    return value.first;
+}
 
 /**
- *  edge_descriptor wrapper used to generate hash, used as key in edge history
+ *  bundled value stored in history entry
  */
-template<typename graph>
-struct hashable_edge_descriptor : graph::edge_descriptor {
-    typedef typename graph::edge_descriptor edge_descriptor;
-    typedef typename graph::vertex_descriptor vertex_descriptor;
-    hashable_edge_descriptor(const edge_descriptor& edge,const graph& g) :
-        graph::edge_descriptor(edge),
-        h(boost::hash<vertex_descriptor>()(boost::source(edge,g))^
-        boost::hash<vertex_descriptor>()(boost::target(edge,g)))
-    {}
-    std::size_t h;
+template<typename property_type>
+const property_type& get_value(const std::pair<revision,property_type>& value){
+    return value.second;
+}
+template<typename key_type, typename property_type>
+property_type& get_value(const split_record<key_type,property_type>& value){
+    return value.second;
+}
+inline no_property get_value(const revision& ){
+    return no_property();
+}
+
+/**
+ *  orders history records by revision, records of single element are pushed
+ *  in increasing revision order, so history is sorted and can be binary searched
+ */
+struct record_revision_less{
+    bool operator()(const revision& a, const revision& b) const{
+        return a<b;
+    }
+    template<typename entry_type>
+    bool operator()(const revision& r, const entry_type& entry) const{
+        return r<get_revision(entry);
+    }
+    template<typename entry_type>
+    bool operator()(const entry_type& entry, const revision& r) const{
+        return get_revision(entry)<r;
+    }
 };
 
+/**
+ *  records of history committed in revisions from..to inclusive, oldest first,
+ *  iterated in place
+ */
+template<typename history_type>
+std::pair<typename history_type::const_iterator,typename history_type::const_iterator>
+records_between(const history_type& hist, const revision& from, const revision& to){
+    return std::make_pair(std::lower_bound(hist.begin(),hist.end(),from,record_revision_less()),
+                          std::upper_bound(hist.begin(),hist.end(),to,record_revision_less()));
+}
 
-template<typename hashable_edge_descriptor>
-struct edge_hash{
-    typedef typename hashable_edge_descriptor::vertex_descriptor vertex_descriptor;
-    std::size_t operator()(const hashable_edge_descriptor& d) const {
-          return d.h;
+/**
+ *  latest record of history not younger than revision r,
+ *  null if element was created after r, found by binary search
+ */
+template<typename history_type>
+typename history_type::const_pointer find_record(const history_type& hist, const revision& r){
+    auto it = std::upper_bound(hist.begin(),hist.end(),r,record_revision_less());
+    return it==hist.begin() ? typename history_type::const_pointer() : typename history_type::const_pointer(it-1);
+}
+
+/**
+ *  checks if element with given history existed and was not deleted in revision r
+ */
+template<typename history_type>
+bool existed_in(const history_type& hist, const revision& r){
+    auto record = find_record(hist,r);
+    return record && !is_deleted(get_revision(*record));
+}
+
+/**
+ *  compares latest history entry with current value of bundled property
+ */
+template<typename property_type>
+bool is_update_needed(const std::pair<revision,property_type>& entry, const property_type& prop){
+    return values_differ(entry.second,prop);
+}
+template<typename key_type, typename stored_type, typename property_type>
+bool is_update_needed(const split_record<key_type,stored_type>& entry, const property_type& prop){
+    return values_differ(entry.second,prop);
+}
+inline bool is_update_needed(const revision& , const no_property& ){
+    return false;
+}
+
+/**
+ * stores value of modified element, entry of the same revision is overwritten
+ */
+template<typename history_type, typename property_type>
+void store_entry(history_type& hist, const revision& r, const property_type& prop){
+    if(get_revision(hist.top())>=r){
+        hist.top() = make_entry(r,prop);
+    } else if(is_update_needed(hist.top(),prop)){
+        hist.push(make_entry(r,prop));
+    }
+}
+
+/**
+ *  vertices and edges touched in single revision, commit() visits only them
+ *  descriptors may repeat or refer to already removed elements,
+ *  dirty flag kept in history holder decides if element needs a visit
+ */
+template<typename vertex_descriptor,typename edge_descriptor,typename allocator_t = std::allocator<char> >
+struct revision_changes{
+    std::vector<vertex_descriptor,typename rebind_allocator<allocator_t,vertex_descriptor>::type> vertices;
+    std::vector<edge_descriptor,typename rebind_allocator<allocator_t,edge_descriptor>::type> edges;
+    void clear(){
+        vertices.clear();
+        edges.clear();
+    }
+    void push(const vertex_descriptor& v){
+        vertices.push_back(v);
+    }
+    void push(const edge_descriptor& e){
+        edges.push_back(e);
+    }
+};
+
+/**
+ *  elements which differ between two revisions, every element is listed once,
+ *  elements created and deleted between revisions are omitted,
+ *  removed elements stay in graph marked as deleted and can be read through as_of()
+ */
+template<typename vertex_descriptor,typename edge_descriptor,typename allocator_t = std::allocator<char> >
+struct revision_diff{
+    revision_changes<vertex_descriptor,edge_descriptor,allocator_t> added;
+    revision_changes<vertex_descriptor,edge_descriptor,allocator_t> removed;
+    revision_changes<vertex_descriptor,edge_descriptor,allocator_t> modified; // bundle differs
+    bool graph_bundle_modified;
+    revision_diff() : graph_bundle_modified(false) {}
+};
+
+/**
+ *  changes delivered to observers after single commit(), undo or revert,
+ *  describes how state of the latest commit changed, added elements are the created ones,
+ *  elements deleted by undo are no longer in graph and their descriptors only identify them,
+ *  revert_changes() does not change state of the latest commit, so its batch is empty
+ */
+template<typename vertex_descriptor,typename edge_descriptor,typename allocator_t = std::allocator<char> >
+struct change_batch : public revision_diff<vertex_descriptor,edge_descriptor,allocator_t>{
+    enum operation_type { commit_operation, undo_operation, revert_operation };
+    operation_type operation;
+    revision rev; // latest committed revision after operation
+    revision_changes<vertex_descriptor,edge_descriptor,allocator_t> resurrected; // deleted elements restored by undo
+    change_batch(operation_type op, revision r) : operation(op),rev(r) {}
+};
+
+/**
+ *  stable identity of edge used as key in edge history,
+ *  address of edge property stored in adjacency_list, the same for both directions of undirected edge
+ */
+template<typename graph_t>
+struct edge_identity{
+    template<typename edge_descriptor>
+    static std::uintptr_t get(const edge_descriptor& e, const graph_t& ){
+        return reinterpret_cast<std::uintptr_t>(e.get_property());
+    }
+};
+
+/**
+ *  identity of adjacency_matrix edge is its cell, edges without property share single property object
+ *  value is shifted by one, zero is reserved for empty slot
+ */
+template<typename Directed, typename VertexProperty,
+         typename EdgeProperty, typename GraphProperty,
+         typename Allocator>
+struct edge_identity<boost::adjacency_matrix<Directed,VertexProperty,EdgeProperty,GraphProperty,Allocator>>{
+    typedef boost::adjacency_matrix<Directed,VertexProperty,EdgeProperty,GraphProperty,Allocator> graph_t;
+    template<typename edge_descriptor>
+    static std::uintptr_t get(const edge_descriptor& e, const graph_t& g){
+        std::uintptr_t u = boost::source(e,g), v = boost::target(e,g);
+        if(!std::is_same<Directed,boost::directedS>::value && u>v){
+            std::swap(u,v);
         }
+        return u*boost::num_vertices(g)+v+1;
+    }
+};
+
+/**
+ *  open addressing hash table with linear probing, keys are non zero edge identities,
+ *  provides subset of std::unordered_map interface used by versioned_graph,
+ *  erase shifts following records back, so references are valid only until next insert or erase
+ */
+template<typename mapped_type, typename allocator_t = std::allocator<char> >
+class flat_edge_map{
+public:
+    typedef std::uintptr_t key_type;
+    typedef std::pair<key_type,mapped_type> value_type;
+    typedef value_type* iterator;
+    typedef const value_type* const_iterator;
+    typedef std::size_t size_type;
+
+    flat_edge_map() : count(0),shift(64) {}
 
+    iterator find(key_type k){
+        if(slots.empty()){
+            return end();
+        }
+        size_type i = probe(k);
+        return slots[i].first==k ? slots.data()+i : end();
+    }
+    const_iterator find(key_type k) const{
+        if(slots.empty()){
+            return end();
+        }
+        size_type i = probe(k);
+        return slots[i].first==k ? slots.data()+i : end();
+    }
+    iterator end(){
+        return slots.data()+slots.size();
+    }
+    const_iterator end() const{
+        return slots.data()+slots.size();
+    }
+    std::pair<iterator,bool> insert(const value_type& v){
+        assert(v.first!=0);
+        if(4*(count+1)>3*slots.size()){
+            rehash(slots.empty() ? 16 : 2*slots.size());
+        }
+        size_type i = probe(v.first);
+        if(slots[i].first==v.first){
+            return std::make_pair(slots.data()+i,false);
+        }
+        slots[i] = v;
+        ++count;
+        return std::make_pair(slots.data()+i,true);
+    }
+    void erase(iterator it){
+        const size_type mask = slots.size()-1;
+        size_type i = it-slots.data();
+        for(size_type j = (i+1)&mask; slots[j].first!=0; j = (j+1)&mask){
+            // record j may fill the gap if gap lies between its bucket and j
+            if(((j-bucket(slots[j].first))&mask) >= ((j-i)&mask)){
+                slots[i] = std::move(slots[j]);
+                i = j;
+            }
+        }
+        slots[i] = value_type(0,mapped_type());
+        --count;
+    }
+    size_type size() const{ return count; }
+    bool empty() const{ return count==0; }
+private:
+    size_type bucket(key_type k) const{
+        return (k*UINT64_C(0x9E3779B97F4A7C15))>>shift;
+    }
+    /**
+     * slot of key or empty slot where it should be inserted
+     */
+    size_type probe(key_type k) const{
+        const size_type mask = slots.size()-1;
+        size_type i = bucket(k);
+        while(slots[i].first!=0 && slots[i].first!=k){
+            i = (i+1)&mask;
+        }
+        return i;
+    }
+    /**
+     * n must be power of two
+     */
+    void rehash(size_type n){
+        assert((n&(n-1))==0);
+        slots_type old(n);
+        old.swap(slots);
+        shift = 64;
+        while(n>1){
+            n >>= 1;
+            --shift;
+        }
+        for(auto& v : old){
+            if(v.first!=0){
+                slots[probe(v.first)] = std::move(v);
+            }
+        }
+    }
+    typedef std::vector<value_type,typename rebind_allocator<allocator_t,value_type>::type> slots_type;
+    slots_type slots;
+    size_type count;
+    unsigned shift; // 64 - log2 of slots.size(), updated by rehash()
 };
 
 /**
@@ -212,46 +636,8 @@ public:
             // default filter for edge, match all
             return true;
         }
-        auto list = g->get_history(v);
-        revision r = detail::get_revision(list.top());
-        assert(r<=g->get_current_rev() && "Top of history is above current rev");
-        if(is_deleted(r)){
-             return false;
-        }
-        return true;
-    }
-};
-
-/**
- * Predicate to decide if vertex v (passed as parameter of operator)
- * is adjacent to vertex u passed in constructor
- * To be used in adjacent_vertices()
- * inv template parameter is a switch between adjacent_vertices() and inv_adjacent_vertices()
- */
-template<typename graph_type, typename vertex_descriptor,bool inv>
-struct adjacency_filter_removed_predicate{
-    vertex_descriptor u;
-    typedef typename boost::graph_traits<graph_type>::vertex_descriptor value_type;
-    const graph_type* g;
-public:
-    adjacency_filter_removed_predicate() : u(),g(nullptr) {}
-    adjacency_filter_removed_predicate(const adjacency_filter_removed_predicate &p) : u(p.u),g(p.g){}
-    adjacency_filter_removed_predicate(const graph_type* graph,vertex_descriptor u) : u(u),g(graph) {}
-    bool operator()(const value_type& v) {
-        if(g==nullptr){
-            // default filter for vertex, match all
-            return true;
-        }
-        auto p = inv ? boost::edge(v,u,g->get_base_graph()) : boost::edge(u,v,g->get_base_graph());
-        assert(p.second && "Wanted edge does not exist");
-        auto edge_desc = p.first;
-        auto list = g->get_history(edge_desc);
-        revision r = detail::get_revision(list.top());
-        assert(r<=g->get_current_rev() && "Top of history is above current rev");
-        if (is_deleted(r)) {
-           return false;
-        }
-        return true;
+        assert(g->get_latest_revision(v)<=g->get_current_rev() && "Top of history is above current rev");
+        return g->is_visible(v);
     }
 };
 
@@ -270,10 +656,12 @@ struct graph_tr{
 template<typename vertices_history_type,typename degree_size_type,typename dir_tag>
 struct vertex_data{
     vertices_history_type hist;
+    bool dirty;
+    std::size_t index; // position in compact index, valid while not deleted
 private:
     degree_size_type out_deg;
 public:
-    vertex_data():hist(),out_deg(0) {}
+    vertex_data():hist(),dirty(false),index(0),out_deg(0) {}
     inline degree_size_type incr_out_degree() {
         return ++out_deg;
     }
@@ -303,11 +691,13 @@ public:
 template<typename vertices_history_type,typename degree_size_type>
 struct vertex_data<vertices_history_type,degree_size_type,bidirectional_tag>{
     vertices_history_type hist;
+    bool dirty;
+    std::size_t index; // position in compact index, valid while not deleted
 private:
     degree_size_type out_deg;
     degree_size_type in_deg;
 public:
-    vertex_data():hist(),out_deg(0),in_deg(0) {}
+    vertex_data():hist(),dirty(false),index(0),out_deg(0),in_deg(0) {}
     inline degree_size_type incr_out_degree() {
         return ++out_deg;
     }
@@ -328,22 +718,249 @@ public:
     }
 };
 
+/**
+ * holder of edge history
+ */
+template<typename edges_history_type>
+struct edge_data{
+    edges_history_type hist;
+    bool dirty;
+    std::size_t dirty_pos; // index in uncommitted changes, valid while dirty
+    std::size_t index; // position in compact index, valid while not deleted
+    edge_data():hist(),dirty(false),dirty_pos(0),index(0) {}
+};
+
+/**
+ * map from dense integral descriptors to stored data, kept in contiguous vector,
+ * provides subset of std::unordered_map interface used by versioned_graph,
+ * descriptors are never removed from the middle (vertices of vecS and adjacency_matrix are not removable)
+ */
+template<typename key_type, typename mapped_type, typename allocator_t = std::allocator<char> >
+class dense_map {
+    typedef std::pair<key_type,mapped_type> item_type;
+    typedef std::vector<item_type,typename rebind_allocator<allocator_t,item_type>::type> items_type;
+public:
+    typedef item_type value_type;
+    typedef typename items_type::iterator iterator;
+    typedef typename items_type::const_iterator const_iterator;
+    typedef typename items_type::size_type size_type;
+
+    iterator find(key_type k){
+        return k<items.size() ? items.begin()+k : items.end();
+    }
+    const_iterator find(key_type k) const{
+        return k<items.size() ? items.begin()+k : items.end();
+    }
+    std::pair<iterator,bool> insert(const value_type& v){
+        if(v.first<items.size()){
+            return std::make_pair(find(v.first),false);
+        }
+        while(items.size()<v.first){
+            items.push_back(value_type(items.size(),mapped_type()));
+        }
+        items.push_back(v);
+        return std::make_pair(items.end()-1,true);
+    }
+    void erase(iterator it){
+        assert(it+1==items.end() && "only last descriptor can be removed");
+        items.erase(it);
+    }
+    iterator begin(){ return items.begin(); }
+    iterator end(){ return items.end(); }
+    const_iterator begin() const{ return items.begin(); }
+    const_iterator end() const{ return items.end(); }
+    size_type size() const{ return items.size(); }
+    bool empty() const{ return items.empty(); }
+private:
+    items_type items;
+};
+
+/**
+ * storage of vertex data, dense vector for integral descriptors (vecS, adjacency_matrix),
+ * hash map otherwise
+ */
+template<typename vertex_descriptor, typename vertex_stored_data, typename allocator_t>
+struct vertex_storage{
+    typedef typename rebind_allocator<allocator_t,std::pair<const vertex_descriptor,vertex_stored_data> >::type node_allocator;
+    typedef typename std::conditional<std::is_integral<vertex_descriptor>::value,
+                                      dense_map<vertex_descriptor,vertex_stored_data,allocator_t>,
+                                      std::unordered_map<vertex_descriptor,vertex_stored_data,boost::hash<vertex_descriptor>,
+                                                         std::equal_to<vertex_descriptor>,node_allocator> >::type type;
+};
+
+/**
+ * edge property of base graph holding given bundle, other properties
+ * of property list (for example edge_index) are default constructed
+ */
+template<typename property_type, typename bundle_type>
+property_type make_edge_property(const bundle_type& bundle, std::false_type){
+    property_type p;
+    lookup_one_property<property_type,edge_bundle_t>::lookup(p,edge_bundle) = bundle;
+    return p;
+}
+template<typename property_type, typename bundle_type>
+const bundle_type& make_edge_property(const bundle_type& bundle, std::true_type){
+    return bundle;
+}
+template<typename property_type, typename bundle_type>
+auto make_edge_property(const bundle_type& bundle)
+    -> decltype(make_edge_property<property_type>(bundle,std::is_same<property_type,bundle_type>())){
+    return make_edge_property<property_type>(bundle,std::is_same<property_type,bundle_type>());
 }
 
-template<typename graph_t>
-class versioned_graph  : public detail::graph_tr<versioned_graph<graph_t>> {
-    typedef detail::graph_tr<versioned_graph<graph_t>> direct_base;
+/**
+ * edge records kept in flat_edge_map keyed by edge identity
+ */
+template<typename graph_t, typename edge_stored_data, typename allocator_t>
+class keyed_edge_storage{
+public:
+    typedef typename boost::graph_traits<graph_t>::edge_descriptor edge_descriptor;
+    static const bool intrusive = false;
+
+    edge_stored_data* find(const edge_descriptor& e, const graph_t& g){
+        auto it = records.find(edge_identity<graph_t>::get(e,g));
+        return it==records.end() ? 0 : &it->second;
+    }
+    const edge_stored_data* find(const edge_descriptor& e, const graph_t& g) const{
+        auto it = records.find(edge_identity<graph_t>::get(e,g));
+        return it==records.end() ? 0 : &it->second;
+    }
+    edge_stored_data& insert(const edge_descriptor& e, const graph_t& g, const edge_stored_data& data){
+        return records.insert(std::make_pair(edge_identity<graph_t>::get(e,g),data)).first->second;
+    }
+    void erase(const edge_descriptor& e, const graph_t& g){
+        auto it = records.find(edge_identity<graph_t>::get(e,g));
+        assert(it!=records.end());
+        records.erase(it);
+    }
+    std::size_t size() const{
+        return records.size();
+    }
+    /**
+     * edge property passed to add_edge() of base graph
+     */
+    template<typename bundle_type>
+    static auto make_property(const bundle_type& prop)
+        -> decltype(make_edge_property<typename graph_t::edge_property_type>(prop)){
+        return make_edge_property<typename graph_t::edge_property_type>(prop);
+    }
+private:
+    flat_edge_map<edge_stored_data,allocator_t> records;
+};
+
+/**
+ * edge records stored inside edge property of base graph (see intrusive_edge_history),
+ * lookup is single dereference of edge descriptor
+ */
+template<typename graph_t, typename edge_stored_data>
+class intrusive_edge_storage{
+    typedef typename graph_t::edge_property_type edge_property_type;
+    static_assert(std::is_same<typename edge_property_type::value_type,edge_stored_data>::value,
+                  "edge_history property has to hold versioned_graph::edge_stored_data");
 public:
-    typedef versioned_graph<graph_t> self_type;
+    typedef typename boost::graph_traits<graph_t>::edge_descriptor edge_descriptor;
+    static const bool intrusive = true;
+
+    intrusive_edge_storage() : count(0) {}
+
+    edge_stored_data* find(const edge_descriptor& e, const graph_t& ){
+        return &static_cast<edge_property_type*>(const_cast<void*>(e.get_property()))->m_value;
+    }
+    const edge_stored_data* find(const edge_descriptor& e, const graph_t& ) const{
+        return &static_cast<const edge_property_type*>(e.get_property())->m_value;
+    }
+    edge_stored_data& insert(const edge_descriptor& e, const graph_t& g, const edge_stored_data& data){
+        edge_stored_data& stored = *find(e,g);
+        stored = data;
+        ++count;
+        return stored;
+    }
+    void erase(const edge_descriptor& e, const graph_t& g){
+        *find(e,g) = edge_stored_data();
+        --count;
+    }
+    std::size_t size() const{
+        return count;
+    }
+    template<typename bundle_type>
+    static edge_property_type make_property(const bundle_type& prop){
+        return edge_property_type(edge_stored_data(),make_edge_property<typename edge_property_type::next_type>(prop));
+    }
+private:
+    std::size_t count;
+};
+
+template<typename edge_property_type>
+struct has_edge_history : std::false_type {};
+
+template<typename T, typename Base>
+struct has_edge_history<boost::property<edge_history_t,T,Base> > : std::true_type {};
+
+template<typename graph_t, typename edge_stored_data, typename allocator_t>
+struct edge_storage{
+    typedef typename std::conditional<has_edge_history<typename graph_t::edge_property_type>::value,
+                                      intrusive_edge_storage<graph_t,edge_stored_data>,
+                                      keyed_edge_storage<graph_t,edge_stored_data,allocator_t> >::type type;
+};
+
+}
+
+/**
+ * adjacency_list with edge history kept in edge property, use as parameter of versioned_graph:
+ * versioned_graph<intrusive_edge_history<adjacency_list<...>>::type>
+ * edge bundle stays the same, history lookup does not need hashing,
+ * allocator has to be the same as allocator of versioned_graph
+ */
+template<typename graph_t, typename allocator_t = detail::default_allocator>
+struct intrusive_edge_history;
+
+template<typename OutEdgeList, typename VertexList,typename  Directed,
+         typename VertexProperties, typename EdgeProperties,
+         typename GraphProperties, typename EdgeList, typename allocator_t>
+struct intrusive_edge_history<boost::adjacency_list<OutEdgeList,VertexList,Directed,VertexProperties,EdgeProperties,GraphProperties,EdgeList>,allocator_t>{
+    typedef typename boost::edge_bundle_type<boost::adjacency_list<OutEdgeList,VertexList,Directed,VertexProperties,EdgeProperties,GraphProperties,EdgeList>>::type edge_bundled;
+    typedef detail::edge_data<typename detail::property_records<edge_bundled,allocator_t>::type> record_type;
+    typedef boost::adjacency_list<OutEdgeList,VertexList,Directed,VertexProperties,
+                                  boost::property<edge_history_t,record_type,EdgeProperties>,
+                                  GraphProperties,EdgeList> type;
+};
+
+/**
+ * Interface of objects notified about changes of versioned graph, see detail::change_batch
+ */
+template<typename batch_type>
+class change_observer{
+public:
+    virtual ~change_observer(){}
+    virtual void on_changes(const batch_type& batch) = 0;
+};
+
+/**
+ * Graph graph_t with history of changes, allocator_t is rebound for history records
+ * and all internal containers, it has to be default constructible (stateless)
+ */
+template<typename graph_t, typename allocator_t = detail::default_allocator>
+class versioned_graph  : public detail::graph_tr<versioned_graph<graph_t,allocator_t>> {
+    typedef detail::graph_tr<versioned_graph<graph_t,allocator_t>> direct_base;
+public:
+    typedef versioned_graph<graph_t,allocator_t> self_type;
     typedef graph_t graph_type;
+    typedef allocator_t allocator_type;
     typedef detail::revision revision;
 
     typedef typename boost::vertex_bundle_type<graph_type>::type vertex_bundled;
     typedef typename boost::edge_bundle_type<graph_type>::type edge_bundled;
     typedef typename boost::graph_bundle_type<graph_type>::type graph_bundled;
-    typedef typename detail::property_records<vertex_bundled>::type vertices_history_type;
-    typedef typename detail::property_records<edge_bundled>::type edges_history_type;
-    typedef typename detail::property_optional_records<graph_bundled> graph_properties_history_type;
+    // no_property bundles are not stored in history and are returned by value
+    typedef typename std::conditional<std::is_same<vertex_bundled,no_property>::value,
+                                      no_property,const vertex_bundled&>::type vertex_bundled_reference;
+    typedef typename std::conditional<std::is_same<edge_bundled,no_property>::value,
+                                      no_property,const edge_bundled&>::type edge_bundled_reference;
+    typedef typename std::conditional<std::is_same<graph_bundled,no_property>::value,
+                                      no_property,const graph_bundled&>::type graph_bundled_reference;
+    typedef typename detail::property_records<vertex_bundled,allocator_t>::type vertices_history_type;
+    typedef typename detail::property_records<edge_bundled,allocator_t>::type edges_history_type;
+    typedef typename detail::property_optional_records<graph_bundled,allocator_t> graph_properties_history_type;
     typedef typename boost::graph_traits<graph_type>::vertex_descriptor vertex_descriptor;
     typedef typename boost::graph_traits<graph_type>::edge_descriptor edge_descriptor;
     typedef typename graph_type::degree_size_type degree_size_type;
@@ -352,18 +969,20 @@ public:
     typedef typename graph_type::traversal_category traversal_category;
     typedef typename graph_type::vertices_size_type vertices_size_type;
     typedef typename graph_type::edges_size_type edges_size_type;
-    typedef typename detail::hashable_edge_descriptor<self_type> edge_key;
+    typedef std::uintptr_t edge_key;
 
     typedef detail::filter_removed_predicate<self_type,vertex_descriptor> vertex_predicate;
     typedef detail::filter_removed_predicate<self_type,edge_descriptor> edge_predicate;
-    typedef detail::adjacency_filter_removed_predicate<self_type,vertex_descriptor,false> adjacency_predicate;
     friend vertex_predicate;
     friend edge_predicate;
-    friend adjacency_predicate;
 
-    typedef typename boost::filter_iterator<
-                                    vertex_predicate,
-                                    typename boost::graph_traits<graph_type>::vertex_iterator>
+    // integral descriptors are iterated by alive bitset, others are filtered by predicate
+    typedef typename std::conditional<std::is_integral<vertex_descriptor>::value,
+                                      detail::alive_iterator<vertex_descriptor,
+                                          typename detail::alive_set_selector<vertex_descriptor,allocator_t>::type>,
+                                      boost::filter_iterator<
+                                          vertex_predicate,
+                                          typename boost::graph_traits<graph_type>::vertex_iterator> >::type
                             vertex_iterator;
     typedef typename boost::filter_iterator<
                                     edge_predicate,
@@ -380,33 +999,48 @@ public:
                                     typename boost::graph_traits<graph_type>::in_edge_iterator>
                              in_edge_iterator;
 
-    typedef typename boost::filter_iterator<
-                                    adjacency_predicate,
-                                    typename boost::graph_traits<graph_type>::adjacency_iterator>
+    // neighbours are targets of not deleted out edges
+    typedef typename boost::adjacency_iterator_generator<self_type,vertex_descriptor,out_edge_iterator>::type
                              adjacency_iterator;
 
     typedef detail::vertex_data<vertices_history_type,degree_size_type,directed_category> vertex_stored_data;
+    typedef detail::edge_data<edges_history_type> edge_stored_data;
+    typedef typename detail::edge_storage<graph_t,edge_stored_data,allocator_t>::type edge_storage_type;
+    typedef detail::revision_changes<vertex_descriptor,edge_descriptor,allocator_t> changes_type;
+    // results handed over to user are kept in standard containers
+    typedef detail::revision_diff<vertex_descriptor,edge_descriptor> diff_type;
+    typedef detail::change_batch<vertex_descriptor,edge_descriptor> change_batch_type;
+    typedef std::vector<vertex_descriptor,typename detail::rebind_allocator<allocator_t,vertex_descriptor>::type> vertex_list;
+    typedef std::vector<edge_descriptor,typename detail::rebind_allocator<allocator_t,edge_descriptor>::type> edge_list;
+    typedef change_observer<change_batch_type> observer_type;
 
     typename graph_traits<graph_t>::vertex_iterator vertices_begin() const;
     typename graph_traits<graph_t>::vertex_iterator vertices_end() const;
     typename graph_traits<graph_t>::edge_iterator edges_begin() const;
     typename graph_traits<graph_t>::edge_iterator edges_end() const;
 
-    versioned_graph() : direct_base(0,graph_bundled()),vertex_count(0),edge_count(0),current_rev(revision::create_start()) {}
-    versioned_graph(vertices_size_type n, const graph_bundled& p = graph_bundled()) : direct_base(n,p),vertex_count(n),edge_count(0),current_rev(revision::create_start()) {
-        std::pair<vertex_iterator, vertex_iterator> vi = vertices(get_base_graph());
-        for(vertex_iterator it = vi.first; it!=vi.second;++it){
+    versioned_graph() : direct_base(0,graph_bundled()),graph_bundle_dirty(false),vertex_count(0),edge_count(0),current_rev(revision::create_start()) {}
+    versioned_graph(vertices_size_type n, const graph_bundled& p = graph_bundled()) : direct_base(n,p),graph_bundle_dirty(false),vertex_count(n),edge_count(0),current_rev(revision::create_start()) {
+        typedef typename graph_type::vertex_iterator v_iter_type;
+        std::pair<v_iter_type, v_iter_type> vi = vertices(get_base_graph());
+        for(v_iter_type it = vi.first; it!=vi.second;++it){
             init(*it);
         }
     }
 
     versioned_graph(const versioned_graph& g );
+    /**
+     * copy constructor remaps stored descriptors and leaves observers behind,
+     * member-wise assignment would do neither
+     */
+    versioned_graph& operator=(const versioned_graph& g) = delete;
 
     template <class EdgeIterator>
     versioned_graph(EdgeIterator first, EdgeIterator last,
                    vertices_size_type n,
                    edges_size_type m = 0,
                    const graph_bundled& p = graph_bundled()) :  direct_base(first,last,n,m,p),
+                                                                graph_bundle_dirty(false),
                                                                 vertex_count(n),edge_count(m),current_rev(revision::create_start()) {
         typedef typename graph_type::vertex_iterator v_iter_type;
         std::pair<v_iter_type, v_iter_type> vi = vertices(get_base_graph());
@@ -444,6 +1078,27 @@ public:
      * implementation of remove_vertex()
      */
     void set_deleted(vertex_descriptor v);
+    /**
+     * implementation of remove_out_edge_if(), clear_out_edges() and remove_edge(u,v),
+     * matching edges are collected into reusable buffer and then removed
+     */
+    template<typename predicate>
+    void remove_out_edges_if(vertex_descriptor u, predicate pred);
+    /**
+     * implementation of remove_in_edge_if() and clear_in_edges()
+     */
+    template<typename predicate>
+    void remove_in_edges_if(vertex_descriptor u, predicate pred);
+    /**
+     * implementation of remove_edge_if()
+     */
+    template<typename predicate>
+    void remove_edges_if(predicate pred);
+    /**
+     * implementation of clear_vertex(), visits only edges incident to u,
+     * except directed graph without in edges, where all edges are checked for target u
+     */
+    void remove_incident_edges(vertex_descriptor u);
     /**
      * Remove edge with history, cannot undo that
      */
@@ -470,6 +1125,79 @@ public:
         return is_deleted(detail::get_revision(get_history(d).top()));
     }
 
+    /**
+     * Checks if base graph holds vertices marked as deleted,
+     * every vertex of base graph has history record, so it is enough to compare counters
+     */
+    bool has_deleted_vertices() const {
+        return vertices_history.size()!=vertex_count;
+    }
+    /**
+     * Checks if base graph holds edges marked as deleted
+     */
+    bool has_deleted_edges() const {
+        return edges_history.size()!=edge_count;
+    }
+    /**
+     * Checks if given vertex is not marked as deleted, used by iterators,
+     * history is read in place and only when some vertex is marked as deleted
+     */
+    bool is_visible(vertex_descriptor d) const {
+        return !has_deleted_vertices() || !check_if_currently_deleted(d);
+    }
+    /**
+     * Checks if given edge is not marked as deleted, used by iterators
+     */
+    bool is_visible(edge_descriptor d) const {
+        return !has_deleted_edges() || !check_if_currently_deleted(d);
+    }
+
+    /**
+     * range of vertices not marked as deleted
+     */
+    std::pair<vertex_iterator,vertex_iterator> get_vertices() const{
+        return get_vertices(std::is_integral<vertex_descriptor>());
+    }
+    /**
+     * n-th vertex not marked as deleted, in order of vertices(),
+     * O(log n) for integral descriptors, linear scan of vertices() otherwise
+     */
+    vertex_descriptor get_vertex(vertices_size_type n) const{
+        return get_vertex(n,std::is_integral<vertex_descriptor>());
+    }
+    /**
+     * position of not deleted vertex v in vertices(), inverse of get_vertex(),
+     * O(log n) for integral descriptors, linear scan of vertices() otherwise
+     */
+    vertices_size_type get_vertex_rank(vertex_descriptor v) const{
+        assert(!check_if_currently_deleted(v));
+        return get_vertex_rank(v,std::is_integral<vertex_descriptor>());
+    }
+
+    /**
+     * edge from u to v not marked as deleted, base graph lookup is used when
+     * parallel edges are not allowed, out edges of u are scanned otherwise
+     */
+    std::pair<edge_descriptor,bool> get_edge(vertex_descriptor u, vertex_descriptor v) const{
+        return get_edge(u,v,edge_parallel_category());
+    }
+
+    /**
+     * index of not deleted vertex in range 0..num_vertices()-1, used as vertex_index property,
+     * removing vertex moves the last indexed vertex to its index
+     */
+    vertices_size_type get_index(vertex_descriptor v) const{
+        assert(!check_if_currently_deleted(v));
+        return get_stored_data(v).index;
+    }
+    /**
+     * index of not deleted edge in range 0..num_edges()-1, used as edge_index property
+     */
+    edges_size_type get_index(edge_descriptor e) const{
+        assert(!check_if_currently_deleted(e));
+        return get_stored_data(e).index;
+    }
+
     vertices_size_type num_vertices() const {
         return vertex_count;
     }
@@ -478,19 +1206,44 @@ public:
     }
     void commit();
     void undo_commit();
+    /**
+     * restores state committed in revision rev (the state read by as_of(g,rev)) and removes
+     * newer commits, equivalent of calling undo_commit() until rev is the last commit,
+     * but visits every touched element once, first commit cannot be undone, same as
+     * in undo_commit(), so rev 0 is treated as revision 1
+     */
+    void undo_to(revision rev);
     void erase_history();
+    /**
+     * elements added, removed or modified after revision from up to revision to,
+     * only changes recorded for revisions in this range are visited,
+     * revision 0 stands for empty graph before the first commit
+     */
+    diff_type get_diff(revision from, revision to) const;
 
-    void revert_uncommited(){
-        clean_edges_to_current_rev();
-        clean_vertices_to_current_rev();
-        (*this)[graph_bundle] = graph_bundled_history.get_latest();
+    /**
+     * observer receives one batch of changes per commit(), undo_commit(), undo_to()
+     * and revert_changes(), batches are built only when some observer is registered,
+     * observers are not copied with graph
+     */
+    void add_observer(observer_type* observer){
+        observers.push_back(observer);
+    }
+    void remove_observer(observer_type* observer){
+        observers.erase(std::remove(observers.begin(),observers.end(),observer),observers.end());
     }
+
+    void revert_uncommited();
     template<typename descriptor>
     revision get_latest_revision(const descriptor& v) const {
         const auto& list = get_history(v);
         return detail::get_revision(list.top());
     }
 
+    edge_key get_edge_key(const edge_descriptor& e) const{
+        return detail::edge_identity<graph_t>::get(e,get_base_graph());
+    }
+
     graph_type& get_base_graph() {
         return *const_cast<graph_type*>(dynamic_cast<const graph_type*>(this));
     }
@@ -510,6 +1263,34 @@ public:
         return current_rev;
     }
 
+    /**
+     * access to bundled properties, non const access marks element as modified
+     * in current revision, so commit() will compare it with history,
+     * non const read of type without operator!= is stored as a write,
+     * writes made directly on get_base_graph() are not tracked
+     */
+    vertex_bundled& operator[](vertex_descriptor v){
+        mark_dirty(v);
+        return get_base_graph()[v];
+    }
+    const vertex_bundled& operator[](vertex_descriptor v) const{
+        return get_base_graph()[v];
+    }
+    edge_bundled& operator[](edge_descriptor e){
+        mark_dirty(e);
+        return get_base_graph()[e];
+    }
+    const edge_bundled& operator[](edge_descriptor e) const{
+        return get_base_graph()[e];
+    }
+    graph_bundled& operator[](graph_bundle_t){
+        graph_bundle_dirty = true;
+        return get_base_graph()[graph_bundle];
+    }
+    const graph_bundled& operator[](graph_bundle_t) const{
+        return get_base_graph()[graph_bundle];
+    }
+
 protected:
     void init(vertex_descriptor v, const vertex_bundled& prop = vertex_bundled());
     void init(edge_descriptor e, const edge_bundled& prop = edge_bundled());
@@ -524,15 +1305,23 @@ protected:
         return iter->second;
     }
 
+    edge_stored_data& get_stored_data(edge_descriptor e){
+        edge_stored_data* data = edges_history.find(e,get_base_graph());
+        assert(data);
+        return *data;
+    }
+    const edge_stored_data& get_stored_data(edge_descriptor e) const {
+        const edge_stored_data* data = edges_history.find(e,get_base_graph());
+        assert(data);
+        return *data;
+    }
+
     vertices_history_type& get_history(vertex_descriptor idx){
         return get_stored_data(idx).hist;
     }
 
     edges_history_type& get_history(edge_descriptor idx){
-        edge_key key(idx,*this);
-        auto iter = edges_history.find(key);
-        assert(iter!=edges_history.end());
-        return iter->second;
+        return get_stored_data(idx).hist;
     }
 public:
     const vertices_history_type& get_history(vertex_descriptor idx)const {
@@ -540,20 +1329,24 @@ public:
     }
 
     const edges_history_type& get_history(edge_descriptor idx)const {
-        edge_key key(idx,*this);
-        auto iter = edges_history.find(key);
-        assert(iter!=edges_history.end());
-        return iter->second;
+        return get_stored_data(idx).hist;
     }
-    const vertex_bundled& get_latest_from_history(vertex_descriptor v) const {
+    vertex_bundled_reference get_latest_from_history(vertex_descriptor v) const {
         return property_handler<self_type,vertex_descriptor,vertex_bundled>::get_latest_bundled_value(v,*this);
     }
-    const edge_bundled& get_latest_from_history(edge_descriptor e) const {
+    edge_bundled_reference get_latest_from_history(edge_descriptor e) const {
         return property_handler<self_type,edge_descriptor,edge_bundled>::get_latest_bundled_value(e,*this);
     }
-    const graph_bundled& get_latest_from_history() const {
+    graph_bundled_reference get_latest_from_history() const {
         return graph_bundled_history.get_latest();
     }
+    /**
+     * graph bundle as it was committed in revision r
+     */
+    graph_bundled_reference get_from_history(revision r) const {
+        assert(r<current_rev);
+        return graph_bundled_history.get_at(r);
+    }
 protected:
     /**
      *  mark edge/vertex as deleted, creates new entry in history
@@ -565,8 +1358,80 @@ protected:
         assert(!check_if_currently_deleted(e) && "Already deleted");
         revision r = current_rev.create_deleted();
         list.push(make_entry(r,dummy_value));
+        mark_dirty(e);
+    }
+
+    /**
+     * adds element to set of elements modified in current revision
+     */
+    template<typename descriptor>
+    void mark_dirty(descriptor d){
+        auto& data = get_stored_data(d);
+        if(!data.dirty){
+            data.dirty = true;
+            add_change(dirty,d,data);
+        }
+    }
+    static void add_change(changes_type& changes, vertex_descriptor v, vertex_stored_data& ){
+        changes.vertices.push_back(v);
+    }
+    static void add_change(changes_type& changes, edge_descriptor e, edge_stored_data& data){
+        data.dirty_pos = changes.edges.size();
+        changes.edges.push_back(e);
     }
 
+    /**
+     * gives element not marked as deleted the next free position of compact index
+     */
+    template<typename descriptor>
+    void index_insert(descriptor d){
+        auto& indexed = indexed_elements(d);
+        get_stored_data(d).index = indexed.size();
+        indexed.push_back(d);
+    }
+    /**
+     * frees position of element being deleted, the last indexed element takes it
+     */
+    template<typename descriptor>
+    void index_erase(descriptor d){
+        auto& indexed = indexed_elements(d);
+        auto index = get_stored_data(d).index;
+        assert(indexed[index]==d);
+        descriptor last = indexed.back();
+        indexed[index] = last;
+        get_stored_data(last).index = index;
+        indexed.pop_back();
+    }
+    vertex_list& indexed_elements(vertex_descriptor){
+        return indexed_vertices;
+    }
+    edge_list& indexed_elements(edge_descriptor){
+        return indexed_edges;
+    }
+
+    /**
+     * removes edge from uncommitted changes before the edge is removed permanently,
+     * so changes never refer to removed edge, which property address may be reused by new edge
+     */
+    void forget_change(edge_descriptor e){
+        edge_stored_data& data = get_stored_data(e);
+        if(!data.dirty){
+            return;
+        }
+        edge_descriptor last = dirty.edges.back();
+        dirty.edges[data.dirty_pos] = last;
+        get_stored_data(last).dirty_pos = data.dirty_pos;
+        dirty.edges.pop_back();
+        data.dirty = false;
+    }
+
+    /**
+     * resets dirty flags of all still existing elements from changes
+     */
+    void reset_dirty_flags(const changes_type& changes);
+    void reset_edge_flags(const changes_type& changes);
+    void reset_vertex_flags(const changes_type& changes);
+
     template<typename graph,typename descriptor_type,typename bundled_prop_type>
     struct property_handler{
 
@@ -581,10 +1446,6 @@ protected:
             assert(detail::get_revision(list.top())<=g.get_current_rev());
             return list.top().second;
         }
-
-        inline static bool is_update_needed(const descriptor_type& d,const graph& g, const bundled_prop_type& new_val){
-            return get_latest_bundled_value(d,g)!=new_val;
-        }
     };
     template<typename graph,typename descriptor_type>
     struct property_handler<graph,descriptor_type,no_property>{
@@ -594,9 +1455,6 @@ protected:
         static no_property get_latest_bundled_value(const descriptor_type& , const graph& ) {
             return no_property();
         }
-        inline static bool is_update_needed(const descriptor_type& , const graph&  , no_property& ){
-            return false;
-        }
     };
 
     void decr_degree(edge_descriptor e);
@@ -615,41 +1473,238 @@ protected:
      * if removed record made vertex marked as deleted adjusts num_vertices() result
      * do not alter vertex attributes
      */
-    void clean_history( vertices_history_type& hist);
+    void clean_history( vertices_history_type& hist, vertex_descriptor desc);
+
+    /**
+     * remove history records at or above current revision for single edge
+     * and restore its bundled property from history
+     * returns false if no record left, then edge has to be removed by remove_created()
+     */
+    bool clean_to_current_rev(edge_descriptor e);
+
+    /**
+     * remove history records at or above current revision for single vertex
+     * and restore its bundled property from history
+     * returns false if no record left, then vertex has to be removed by remove_created()
+     */
+    bool clean_to_current_rev(vertex_descriptor v);
+
+    /**
+     * remove edge created at or above current revision, adjusts degree and num_edges()
+     */
+    void remove_created(edge_descriptor e);
+
+    /**
+     * remove vertex created at or above current revision, adjusts num_vertices()
+     */
+    void remove_created(vertex_descriptor v);
+
+    /**
+     * replays uncommited changes and changes of revisions stored in committed_changes
+     * starting from index first, newest first, edges before vertices,
+     * cleaning every touched element to current revision, cost depends only on number of changes
+     */
+    void rollback(std::size_t first);
+    /**
+     * adds element to diff if its first record after revision from is in revision r,
+     * so element recorded in many revisions is classified once
+     */
+    template<typename descriptor,typename history_type>
+    static void classify_change(diff_type& result, descriptor d, const history_type& hist,
+                                revision from, revision to, revision r);
+    /**
+     * observers are called on copy of the list, so they may add or remove observers,
+     * observer removed during notification still receives current batch
+     */
+    void notify(const change_batch_type& batch) const{
+        const auto called = observers;
+        for(auto observer : called){
+            observer->on_changes(batch);
+        }
+    }
+
+    /**
+     * cleans not yet visited elements from changes, dirty flag marks visited ones,
+     * created edges are collected and removed after their flags are reset
+     */
+    void rollback_edges(const changes_type& changes, edge_list& will_remove);
+    void rollback_vertices(const changes_type& changes);
 
     void clean_edges_to_current_rev();
 
     void clean_vertices_to_current_rev();
 private:
-    std::unordered_map<vertex_descriptor,vertex_stored_data,boost::hash<vertex_descriptor> > vertices_history;
-    std::unordered_map<edge_key,edges_history_type,detail::edge_hash<edge_key> > edges_history;
+    std::pair<vertex_iterator,vertex_iterator> get_vertices(std::true_type) const{
+        vertex_iterator first(&alive_vertices,alive_vertices.next(0));
+        vertex_iterator last(&alive_vertices,alive_vertices.size());
+        return std::make_pair(first,last);
+    }
+    std::pair<vertex_iterator,vertex_iterator> get_vertices(std::false_type) const{
+        vertex_predicate predicate(this);
+        auto end = vertices_end();
+        return std::make_pair(vertex_iterator(predicate,vertices_begin(),end),vertex_iterator(predicate,end,end));
+    }
+    vertex_descriptor get_vertex(vertices_size_type n, std::true_type) const{
+        assert(n<vertex_count);
+        return alive_vertices.select(n);
+    }
+    vertex_descriptor get_vertex(vertices_size_type n, std::false_type) const{
+        vertex_iterator it = get_vertices().first;
+        std::advance(it,n);
+        return *it;
+    }
+    vertices_size_type get_vertex_rank(vertex_descriptor v, std::true_type) const{
+        return alive_vertices.rank(v);
+    }
+    vertices_size_type get_vertex_rank(vertex_descriptor v, std::false_type) const{
+        auto range = get_vertices();
+        return std::distance(range.first,std::find(range.first,range.second,v));
+    }
+
+    std::pair<edge_descriptor,bool> get_edge(vertex_descriptor u, vertex_descriptor v, boost::disallow_parallel_edge_tag) const{
+        // matrix or set lookup, the only u-v edge may be marked as deleted
+        std::pair<edge_descriptor,bool> p = boost::edge(u,v,get_base_graph());
+        if(p.second && !is_visible(p.first)){
+            p.second = false;
+        }
+        return p;
+    }
+    std::pair<edge_descriptor,bool> get_edge(vertex_descriptor u, vertex_descriptor v, boost::allow_parallel_edge_tag) const{
+        // some of parallel edges may be marked as deleted
+        typename boost::graph_traits<graph_type>::out_edge_iterator it,end;
+        for(boost::tie(it,end) = boost::out_edges(u,get_base_graph());it!=end;++it){
+            if(boost::target(*it,get_base_graph())==v && is_visible(*it)){
+                return std::make_pair(*it,true);
+            }
+        }
+        return std::make_pair(edge_descriptor(),false);
+    }
+
+    /**
+     * appends edges of range accepted by pred to edge_buffer, in undirected graph
+     * self loop is listed twice among edges of its vertex, both copies are stored
+     * next to each other (out edge list keeps insertion order or is ordered by target),
+     * so the copy equal to the last collected edge is skipped in O(1)
+     */
+    template<typename iterator, typename predicate>
+    void collect_edges(iterator first, iterator last, predicate pred);
+    /**
+     * removes edges collected in edge_buffer
+     */
+    void remove_collected_edges();
+    void remove_incident_edges(vertex_descriptor u, boost::undirected_tag);
+    void remove_incident_edges(vertex_descriptor u, boost::bidirectional_tag);
+    void remove_incident_edges(vertex_descriptor u, boost::directed_tag);
+
+    typename detail::alive_set_selector<vertex_descriptor,allocator_t>::type alive_vertices;
+    typename detail::vertex_storage<vertex_descriptor,vertex_stored_data,allocator_t>::type vertices_history;
+    edge_storage_type edges_history;
     graph_properties_history_type graph_bundled_history;
+    bool graph_bundle_dirty;
+    changes_type dirty;
+    edge_list edge_buffer; // edges to be removed, kept to reuse its memory
+    vertex_list indexed_vertices; // not deleted vertices by compact index
+    edge_list indexed_edges; // not deleted edges by compact index
+    std::vector<changes_type,typename detail::rebind_allocator<allocator_t,changes_type>::type> committed_changes; // changes of revision r stored at index r-1
     vertices_size_type vertex_count;
     edges_size_type edge_count;
     revision current_rev;
+    std::vector<observer_type*,typename detail::rebind_allocator<allocator_t,observer_type*>::type> observers;
 };
 
 namespace detail {
 
 
+/**
+ * selects descriptor type of bundled member pointer, vertex bundle is checked first
+ */
+template<typename graph_t, typename bundle_t>
+struct bundle_descriptor {
+    typedef typename std::conditional<std::is_same<typename graph_t::vertex_bundled,bundle_t>::value,
+                                      typename graph_t::vertex_descriptor,
+                                      typename graph_t::edge_descriptor>::type type;
+};
+
+/**
+ * property map of bundled member, reads are direct,
+ * writes go through versioned_graph::operator[] so element is marked as modified,
+ * read only for const graph
+ */
+template<typename graph_t, typename descriptor, typename bundle_t, typename T>
+class versioned_bundle_property_map {
+public:
+    typedef descriptor key_type;
+    typedef T value_type;
+    typedef const T& reference;
+    typedef typename std::conditional<std::is_const<graph_t>::value,
+                                      boost::readable_property_map_tag,
+                                      boost::read_write_property_map_tag>::type category;
+
+    versioned_bundle_property_map() : g(0), pm(0) {}
+    versioned_bundle_property_map(graph_t* g, T bundle_t::* pm) : g(g), pm(pm) {}
+
+    reference operator[](key_type k) const {
+        return static_cast<const graph_t&>(*g)[k].*pm;
+    }
+
+    friend reference get(const versioned_bundle_property_map& m, key_type k){
+        return m[k];
+    }
+
+    friend void put(const versioned_bundle_property_map& m, key_type k, const value_type& v){
+        (*m.g)[k].*m.pm = v;
+    }
+private:
+    graph_t* g;
+    T bundle_t::* pm;
+};
+
+/**
+ * vertex_index and edge_index property map, values are positions
+ * of not deleted elements in compact index of versioned graph
+ */
+template<typename graph_t, typename descriptor, typename index_type>
+class versioned_index_map {
+public:
+    typedef descriptor key_type;
+    typedef index_type value_type;
+    typedef index_type reference;
+    typedef boost::readable_property_map_tag category;
+
+    versioned_index_map() : g(0) {}
+    explicit versioned_index_map(const graph_t* g) : g(g) {}
+
+    reference operator[](key_type k) const {
+        return g->get_index(k);
+    }
+
+    friend reference get(const versioned_index_map& m, key_type k){
+        return m[k];
+    }
+private:
+    const graph_t* g;
+};
+
 /**
  * Base type of versioned graph providing inv_adjacency_iterator type definition
  * in case adjacency list is parameter
  */
 template<typename OutEdgeList, typename VertexList,typename  Directed,
          typename VertexProperties, typename EdgeProperties,
-         typename GraphProperties, typename EdgeList>
-struct graph_tr<boost::versioned_graph<boost::adjacency_list<OutEdgeList,VertexList,Directed,VertexProperties,EdgeProperties,GraphProperties,EdgeList>>> : public boost::adjacency_list<OutEdgeList,VertexList,Directed,VertexProperties,EdgeProperties,GraphProperties,EdgeList>{
+         typename GraphProperties, typename EdgeList, typename allocator_t>
+struct graph_tr<boost::versioned_graph<boost::adjacency_list<OutEdgeList,VertexList,Directed,VertexProperties,EdgeProperties,GraphProperties,EdgeList>,allocator_t>> : public boost::adjacency_list<OutEdgeList,VertexList,Directed,VertexProperties,EdgeProperties,GraphProperties,EdgeList>{
     typedef typename boost::adjacency_list<OutEdgeList,VertexList,Directed,VertexProperties,EdgeProperties,GraphProperties,EdgeList> graph_type;
     typedef typename boost::graph_bundle_type<graph_type>::type graph_bundled;
     typedef typename boost::graph_traits<graph_type>::vertex_descriptor vertex_descriptor;
     typedef typename boost::graph_traits<graph_type>::vertices_size_type vertices_size_type;
     typedef typename boost::graph_traits<graph_type>::edges_size_type edges_size_type;
     typedef typename std::is_same<boost::vecS,VertexList> non_removable_vertex;
-    typedef typename boost::detail::adjacency_filter_removed_predicate<versioned_graph<graph_type>,typename graph_type::vertex_descriptor,true> inv_adjacency_predicate;
     typedef typename boost::filter_iterator<
-                                    inv_adjacency_predicate,
-                                    typename graph_type::inv_adjacency_iterator>
+                                    filter_removed_predicate<versioned_graph<graph_type,allocator_t>,typename graph_type::edge_descriptor>,
+                                    typename graph_type::in_edge_iterator>
+                             filtered_in_edge_iterator;
+    // neighbours are sources of not deleted in edges
+    typedef typename boost::inv_adjacency_iterator_generator<versioned_graph<graph_type,allocator_t>,vertex_descriptor,filtered_in_edge_iterator>::type
                              inv_adjacency_iterator;
     graph_tr(typename graph_type::vertices_size_type n, const graph_bundled& p = graph_bundled()) : graph_type(n,p){
     }
@@ -666,8 +1721,8 @@ struct graph_tr<boost::versioned_graph<boost::adjacency_list<OutEdgeList,VertexL
  */
 template<typename Directed, typename VertexProperty,
          typename EdgeProperty, typename GraphProperty,
-         typename Allocator>
-struct graph_tr<boost::versioned_graph<boost::adjacency_matrix<Directed,VertexProperty,EdgeProperty,GraphProperty,Allocator>>> : public boost::adjacency_matrix<Directed,VertexProperty,EdgeProperty,GraphProperty,Allocator> {
+         typename Allocator, typename allocator_t>
+struct graph_tr<boost::versioned_graph<boost::adjacency_matrix<Directed,VertexProperty,EdgeProperty,GraphProperty,Allocator>,allocator_t>> : public boost::adjacency_matrix<Directed,VertexProperty,EdgeProperty,GraphProperty,Allocator> {
     typedef typename boost::adjacency_matrix<Directed,VertexProperty,EdgeProperty,GraphProperty,Allocator> graph_type;
     typedef typename boost::graph_traits<graph_type>::vertex_descriptor vertex_descriptor;
     typedef typename boost::graph_bundle_type<graph_type>::type graph_bundled;
@@ -0,0 +1,626 @@
+/***
+ * author: Damian Lipka
+ *
+ * */
+
+#include "versioned_graph.h"
+#include "versioned_graph_freeze.h"
+#include "versioned_graph_shared.h"
+#include "versioned_graph_view.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <stack>
+#include <string>
+#include <thread>
+
+/***
+ * Benchmarks of versioned_graph, usage:
+ * Benchmark [number of elements]
+ * */
+
+namespace {
+
+std::atomic<std::size_t> live_bytes(0);
+std::atomic<std::size_t> allocations(0);
+
+}
+
+void* operator new(std::size_t size){
+    std::size_t* p = static_cast<std::size_t*>(std::malloc(size+sizeof(std::size_t)));
+    if(!p){
+        throw std::bad_alloc();
+    }
+    *p = size;
+    live_bytes += size;
+    ++allocations;
+    return p+1;
+}
+
+void operator delete(void* ptr) noexcept{
+    if(ptr){
+        std::size_t* p = static_cast<std::size_t*>(ptr)-1;
+        live_bytes -= *p;
+        std::free(p);
+    }
+}
+
+namespace {
+
+using namespace boost;
+
+struct measurement {
+    std::size_t bytes;
+    std::size_t allocations;
+    double seconds;
+};
+
+/**
+ * history records of single element stored whole in one array, the layout versioned_graph
+ * used before split_history, kept here as baseline, first inline_count records are stored
+ * inside the object, longer history is moved to contiguous buffer taken from Alloc
+ */
+template<typename T, unsigned inline_count = 2, typename Alloc = std::allocator<T> >
+class small_history {
+public:
+    typedef T value_type;
+    typedef Alloc allocator_type;
+    typedef std::uint32_t size_type;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+    typedef const T* const_pointer;
+
+    small_history() : data(inline_data()), count(0), capacity(inline_count) {}
+
+    small_history(const small_history& other) : data(inline_data()), count(0), capacity(inline_count) {
+        reserve(other.count);
+        std::uninitialized_copy(other.begin(),other.end(),data);
+        count = other.count;
+    }
+
+    small_history(small_history&& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+        : data(inline_data()), count(0), capacity(inline_count) {
+        take(other);
+    }
+
+    small_history& operator=(const small_history& other){
+        if(this!=&other){
+            small_history copy(other);
+            clear();
+            take(copy);
+        }
+        return *this;
+    }
+
+    small_history& operator=(small_history&& other) noexcept(std::is_nothrow_move_constructible<T>::value){
+        if(this!=&other){
+            clear();
+            take(other);
+        }
+        return *this;
+    }
+
+    ~small_history(){
+        clear();
+    }
+
+    void push(const T& value){
+        if(count==capacity){
+            T copy(value); // value may refer to element of this history
+            grow(capacity*2);
+            ::new (static_cast<void*>(data+count)) T(std::move(copy));
+        } else {
+            ::new (static_cast<void*>(data+count)) T(value);
+        }
+        ++count;
+    }
+
+    void pop(){
+        BOOST_ASSERT(count>0);
+        --count;
+        data[count].~T();
+    }
+
+    reference top(){
+        BOOST_ASSERT(count>0);
+        return data[count-1];
+    }
+    const_reference top() const{
+        BOOST_ASSERT(count>0);
+        return data[count-1];
+    }
+
+    reference operator[](size_type i){
+        BOOST_ASSERT(i<count);
+        return data[i];
+    }
+    const_reference operator[](size_type i) const{
+        BOOST_ASSERT(i<count);
+        return data[i];
+    }
+
+    iterator begin(){ return data; }
+    iterator end(){ return data+count; }
+    const_iterator begin() const{ return data; }
+    const_iterator end() const{ return data+count; }
+
+    size_type size() const{ return count; }
+    bool empty() const{ return count==0; }
+
+    /**
+     * removes all records, heap buffer is released
+     */
+    void clear(){
+        while(count>0){
+            pop();
+        }
+        if(!is_inline()){
+            allocator_type().deallocate(data,capacity);
+            data = inline_data();
+            capacity = inline_count;
+        }
+    }
+
+    void reserve(size_type n){
+        if(n>capacity){
+            grow(n);
+        }
+    }
+
+    /**
+     * bytes allocated outside of the object
+     */
+    std::size_t heap_bytes() const{
+        return is_inline() ? 0 : capacity*sizeof(T);
+    }
+
+private:
+    bool is_inline() const{
+        return data==inline_data();
+    }
+    T* inline_data(){
+        return reinterpret_cast<T*>(&storage);
+    }
+    const T* inline_data() const{
+        return reinterpret_cast<const T*>(&storage);
+    }
+
+    void grow(size_type n){
+        T* buffer = allocator_type().allocate(n);
+        for(size_type i=0;i<count;++i){
+            ::new (static_cast<void*>(buffer+i)) T(std::move(data[i]));
+            data[i].~T();
+        }
+        if(!is_inline()){
+            allocator_type().deallocate(data,capacity);
+        }
+        data = buffer;
+        capacity = n;
+    }
+
+    /**
+     * takes records of other (which has to be empty or already cleared here), other is left empty
+     */
+    void take(small_history& other){
+        if(other.is_inline()){
+            for(size_type i=0;i<other.count;++i){
+                ::new (static_cast<void*>(data+i)) T(std::move(other.data[i]));
+            }
+            count = other.count;
+            other.clear();
+        } else {
+            data = other.data;
+            count = other.count;
+            capacity = other.capacity;
+            other.data = other.inline_data();
+            other.count = 0;
+            other.capacity = inline_count;
+        }
+    }
+
+    typename std::aligned_storage<sizeof(T)*inline_count,std::alignment_of<T>::value>::type storage;
+    T* data;
+    size_type count;
+    size_type capacity;
+};
+
+template<typename F>
+measurement measure(F f){
+    std::size_t bytes_before = live_bytes, allocations_before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto stop = std::chrono::steady_clock::now();
+    measurement m;
+    m.bytes = live_bytes - bytes_before;
+    m.allocations = allocations - allocations_before;
+    m.seconds = std::chrono::duration<double>(stop-start).count();
+    return m;
+}
+
+void report(const std::string& name, const measurement& m, std::size_t n){
+    std::cout << name << ": " << m.bytes/n << " bytes/element, "
+              << double(m.allocations)/n << " allocations/element, "
+              << m.seconds << " s" << std::endl;
+}
+
+/**
+ * record of revision r, records without bundle are revision only
+ */
+template<typename entry_type>
+entry_type make_record(int r, int value){
+    return entry_type(detail::revision::create(r),value);
+}
+template<>
+detail::revision make_record<detail::revision>(int r, int){
+    return detail::revision::create(r);
+}
+
+/**
+ * heap usage of single element history holding given number of records
+ */
+template<typename history_type>
+void history_memory(const std::string& name, std::size_t n, int records){
+    typedef typename history_type::value_type entry_type;
+    history_type* histories = 0;
+    measurement m = measure([&](){
+        histories = new history_type[n];
+        for(std::size_t i=0;i<n;++i){
+            for(int r=1;r<=records;++r){
+                histories[i].push(make_record<entry_type>(r,int(i)));
+            }
+        }
+    });
+    report(name + " x" + std::to_string(records),m,n);
+    delete[] histories;
+}
+
+/**
+ * records of n elements pushed past inline capacity and released again,
+ * as in backtracking loop where records of revision are created and removed together
+ */
+template<typename history_type>
+void history_churn(const std::string& name, std::size_t n){
+    typedef typename history_type::value_type entry_type;
+    std::vector<history_type> histories(n);
+    measurement m = measure([&](){
+        for(int round=0;round<10;++round){
+            for(std::size_t i=0;i<n;++i){
+                for(int r=1;r<=3;++r){
+                    histories[i].push(entry_type(detail::revision::create(r),int(i)));
+                }
+            }
+            for(std::size_t i=0;i<n;++i){
+                histories[i].clear();
+            }
+        }
+    });
+    report(name + " push and release",m,10*n);
+}
+
+/**
+ * heap usage of whole graph with history of every element
+ */
+template<typename graph_type>
+void graph_memory(const std::string& name, std::size_t n){
+    graph_type* g = 0;
+    measurement m = measure([&](){
+        g = new graph_type(n);
+        std::vector<typename graph_traits<graph_type>::vertex_descriptor> vs;
+        vs.reserve(n);
+        typename graph_traits<graph_type>::vertex_iterator it,end;
+        for(boost::tie(it,end) = vertices(*g);it!=end;++it){
+            vs.push_back(*it);
+        }
+        std::srand(1);
+        for(std::size_t i=0;i<4*n;++i){
+            add_edge(vs[std::rand()%n],vs[std::rand()%n],int(i),*g);
+        }
+        commit(*g);
+    });
+    report(name,m,5*n);
+    delete g;
+}
+
+/**
+ * graph with 1 KiB vertex bundles committed in 5 revisions, each changing 10% of vertices,
+ * then copied and undone
+ */
+template<typename bundle_type>
+void bundle_memory(const std::string& name, std::size_t n){
+    typedef versioned_graph<adjacency_list<vecS,vecS,directedS,bundle_type>> graph_type;
+    graph_type* g = 0;
+    graph_type* copy = 0;
+    measurement m = measure([&](){
+        g = new graph_type();
+        for(std::size_t i=0;i<n;++i){
+            add_vertex(bundle_type(std::string(1024,'a'+i%26)),*g);
+        }
+        commit(*g);
+        std::srand(1);
+        for(int r=0;r<5;++r){
+            for(std::size_t i=0;i<n/10;++i){
+                (*g)[std::rand()%n] = bundle_type(std::string(1024,'a'+r));
+            }
+            commit(*g);
+        }
+        copy = new graph_type(*g);
+        undo_commit(*g);
+    });
+    report(name,m,n);
+    delete copy;
+    delete g;
+}
+
+/**
+ * sum over vertices(), edges() and out_edges() of every vertex,
+ * touches descriptors only, so cost of filtering deleted elements dominates
+ */
+template<typename graph_type>
+std::size_t traverse(const graph_type& g){
+    std::size_t sum = 0;
+    typename graph_traits<graph_type>::vertex_iterator vi,vi_end;
+    for(boost::tie(vi,vi_end) = vertices(g);vi!=vi_end;++vi){
+        typename graph_traits<graph_type>::out_edge_iterator ei,ei_end;
+        for(boost::tie(ei,ei_end) = out_edges(*vi,g);ei!=ei_end;++ei){
+            ++sum;
+        }
+    }
+    typename graph_traits<graph_type>::edge_iterator ei,ei_end;
+    for(boost::tie(ei,ei_end) = edges(g);ei!=ei_end;++ei){
+        ++sum;
+    }
+    return sum;
+}
+
+/**
+ * iteration over base graph compared with versioned graph holding the same edges,
+ * then with every tenth edge removed in the next revision
+ */
+template<typename base_graph>
+void iteration_time(const std::string& name, std::size_t n){
+    typedef versioned_graph<base_graph> graph_type;
+    base_graph raw(n);
+    graph_type g(n);
+    std::vector<typename graph_traits<graph_type>::vertex_descriptor> vs;
+    typename graph_traits<graph_type>::vertex_iterator it,end;
+    for(boost::tie(it,end) = vertices(g);it!=end;++it){
+        vs.push_back(*it);
+    }
+    std::vector<typename graph_traits<base_graph>::vertex_descriptor> raw_vs;
+    typename graph_traits<base_graph>::vertex_iterator rit,rend;
+    for(boost::tie(rit,rend) = vertices(raw);rit!=rend;++rit){
+        raw_vs.push_back(*rit);
+    }
+    std::vector<typename graph_traits<graph_type>::edge_descriptor> es;
+    std::srand(1);
+    for(std::size_t i=0;i<4*n;++i){
+        std::size_t u = std::rand()%n, v = std::rand()%n;
+        add_edge(raw_vs[u],raw_vs[v],int(i),raw);
+        es.push_back(add_edge(vs[u],vs[v],int(i),g).first);
+    }
+    commit(g);
+    std::size_t sum = 0;
+    report(name + " base graph",measure([&](){ sum += traverse(raw); }),5*n);
+    report(name + " versioned_graph",measure([&](){ sum += traverse(g); }),5*n);
+    for(std::size_t i=0;i<es.size();i+=10){
+        remove_edge(es[i],g);
+    }
+    commit(g);
+    report(name + " versioned_graph, 10% deleted",measure([&](){ sum += traverse(g); }),5*n);
+    frozen_graph<base_graph>* frozen = 0;
+    report(name + " freeze()",measure([&](){ frozen = new frozen_graph<base_graph>(g); }),5*n);
+    report(name + " frozen_graph",measure([&](){ sum += traverse(frozen->graph()); }),5*n);
+    delete frozen;
+    std::cout << "(" << sum << ")" << std::endl;
+}
+
+/**
+ * iteration over vertices and vertex(n) after half of vertices was removed
+ */
+template<typename base_graph>
+void deleted_vertices_time(const std::string& name, std::size_t n){
+    typedef versioned_graph<base_graph> graph_type;
+    graph_type g(n);
+    std::vector<typename graph_traits<graph_type>::vertex_descriptor> vs(vertices(g).first,vertices(g).second);
+    commit(g);
+    std::srand(1);
+    for(std::size_t i=0;i<n;++i){
+        if(std::rand()%2){
+            remove_vertex(vs[i],g);
+        }
+    }
+    std::size_t sum = 0;
+    report(name + " vertices(), 50% deleted",measure([&](){
+        for(int r=0;r<10;++r){
+            sum += std::distance(vertices(g).first,vertices(g).second);
+        }
+    }),10*n);
+    std::size_t alive = num_vertices(g);
+    report(name + " vertex(n), 50% deleted",measure([&](){
+        for(std::size_t i=0;i<1000;++i){
+            sum += vertex(std::rand()%alive,g)!=vs[0];
+        }
+    }),1000);
+    std::cout << "(" << sum << ")" << std::endl;
+}
+
+/**
+ * reading value of vertex modified in each of n commits as it was in random revision
+ */
+void history_lookup_time(std::size_t n){
+    typedef versioned_graph<adjacency_list<vecS,vecS,directedS,int>> graph_type;
+    graph_type g(1);
+    for(std::size_t r=1;r<=n;++r){
+        g[0] = int(r);
+        commit(g);
+    }
+    std::size_t sum = 0;
+    std::srand(1);
+    report("as_of(g, r)[v], " + std::to_string(n) + " records",measure([&](){
+        for(std::size_t i=0;i<100000;++i){
+            sum += as_of(g,graph_type::revision::create(1+std::rand()%n))[0];
+        }
+    }),100000);
+    std::cout << "(" << sum << ")" << std::endl;
+}
+
+/**
+ * monotonic arena of single thread, deallocation is no-op and memory is returned by release()
+ */
+class thread_arena {
+public:
+    enum { chunk_size = 1<<20 };
+
+    static thread_arena& local(){
+        static thread_local thread_arena arena;
+        return arena;
+    }
+    void* allocate(std::size_t bytes){
+        bytes = (bytes+15)&~std::size_t(15);
+        if(std::size_t(limit-cursor)<bytes){
+            std::size_t size = std::max<std::size_t>(chunk_size,bytes);
+            cursor = static_cast<char*>(::operator new(size));
+            limit = cursor+size;
+            chunks.push_back(cursor);
+        }
+        void* p = cursor;
+        cursor += bytes;
+        return p;
+    }
+    void release(){
+        for(char* chunk : chunks){
+            ::operator delete(chunk);
+        }
+        chunks.clear();
+        cursor = limit = 0;
+    }
+    ~thread_arena(){
+        release();
+    }
+private:
+    thread_arena() : cursor(0),limit(0) {}
+    std::vector<char*> chunks;
+    char* cursor;
+    char* limit;
+};
+
+template<typename T>
+struct arena_allocator {
+    typedef T value_type;
+    arena_allocator() {}
+    template<typename U>
+    arena_allocator(const arena_allocator<U>&) {}
+    T* allocate(std::size_t n){
+        return static_cast<T*>(thread_arena::local().allocate(n*sizeof(T)));
+    }
+    void deallocate(T*, std::size_t){
+    }
+};
+template<typename T, typename U>
+bool operator==(const arena_allocator<T>&, const arena_allocator<U>&){ return true; }
+template<typename T, typename U>
+bool operator!=(const arena_allocator<T>&, const arena_allocator<U>&){ return false; }
+
+/**
+ * search worker owning its graph: builds it, then tries changes of 10% of vertices
+ * and edges and takes them back by undo_commit(), as backtracking search does
+ */
+template<typename graph_type>
+void search_worker(std::size_t n, unsigned seed){
+    std::minstd_rand random(seed);
+    {
+        graph_type g;
+        std::vector<typename graph_traits<graph_type>::vertex_descriptor> vs;
+        vs.reserve(n);
+        for(std::size_t i=0;i<n;++i){
+            vs.push_back(add_vertex(int(i),g));
+        }
+        for(std::size_t i=0;i<4*n;++i){
+            add_edge(vs[random()%n],vs[random()%n],int(i),g);
+        }
+        commit(g);
+        for(int round=0;round<20;++round){
+            for(std::size_t i=0;i<n/10;++i){
+                g[vs[random()%n]] += 1;
+                add_edge(vs[random()%n],vs[random()%n],round,g);
+            }
+            commit(g);
+            undo_commit(g);
+        }
+    }
+    thread_arena::local().release();
+}
+
+/**
+ * search workers running in parallel, each on graph with n/threads vertices
+ */
+template<typename allocator_t>
+void worker_time(const std::string& name, std::size_t n, unsigned threads){
+    typedef versioned_graph<adjacency_list<vecS,vecS,directedS,int,int>,allocator_t> graph_type;
+    measurement m = measure([&](){
+        std::vector<std::thread> workers;
+        for(unsigned t=0;t<threads;++t){
+            workers.push_back(std::thread(search_worker<graph_type>,n/threads,t+1));
+        }
+        for(std::thread& w : workers){
+            w.join();
+        }
+    });
+    report(name,m,n);
+}
+
+}
+
+int main(int argc, char** argv){
+    std::size_t n = argc>1 ? std::strtoul(argv[1],0,10) : 200000;
+    typedef std::pair<detail::revision,int> entry_type;
+    typedef std::pair<detail::revision,double> wide_entry_type;
+
+    std::cout << "history of single element" << std::endl;
+    for(int records=1;records<=3;++records){
+        history_memory<std::stack<entry_type> >("std::stack",n,records);
+        history_memory<small_history<entry_type> >("small_history",n,records);
+        history_memory<small_history<entry_type,2,detail::pool_allocator<entry_type> > >("small_history, pool",n,records);
+        history_memory<detail::split_history<detail::revision,int,2,detail::pool_allocator<char> > >("split_history, pool",n,records);
+        history_memory<small_history<wide_entry_type,2,detail::pool_allocator<wide_entry_type> > >("small_history, double, pool",n,records);
+        history_memory<detail::split_history<detail::revision,double,2,detail::pool_allocator<char> > >("split_history, double, pool",n,records);
+    }
+    // element without bundle is created and deleted, so it has at most two records
+    for(int records=1;records<=2;++records){
+        history_memory<std::stack<detail::revision> >("std::stack, no_property",n,records);
+        history_memory<small_history<detail::revision> >("small_history, no_property",n,records);
+        history_memory<detail::existence_history>("existence_history",n,records);
+    }
+    history_churn<small_history<entry_type> >("small_history",n);
+    history_churn<small_history<entry_type,2,detail::pool_allocator<entry_type> > >("small_history, pool",n);
+
+    std::cout << "graph with " << n << " vertices and " << 4*n << " edges" << std::endl;
+    graph_memory<versioned_graph<adjacency_list<vecS,vecS,directedS,int,int>>>("vecS",n);
+    graph_memory<versioned_graph<adjacency_list<vecS,vecS,directedS,int,int>,detail::pool_allocator<char> > >("vecS, pool",n);
+    graph_memory<versioned_graph<adjacency_list<listS,listS,bidirectionalS,int,int>>>("listS",n);
+
+    std::cout << "graph with " << n/100 << " vertices with 1 KiB bundles, 5 revisions and copy" << std::endl;
+    bundle_memory<std::string>("std::string",n/100);
+    bundle_memory<shared_bundle<std::string> >("shared_bundle<std::string>",n/100);
+
+    std::cout << "iteration over graph with " << n << " vertices and " << 4*n << " edges" << std::endl;
+    iteration_time<adjacency_list<vecS,vecS,directedS,int,int>>("vecS",n);
+    iteration_time<adjacency_list<listS,listS,bidirectionalS,int,int>>("listS",n);
+    deleted_vertices_time<adjacency_list<vecS,vecS,bidirectionalS,int,int>>("vecS",n);
+    deleted_vertices_time<adjacency_list<vecS,listS,bidirectionalS,int,int>>("listS",n);
+
+    std::cout << "history of single vertex" << std::endl;
+    history_lookup_time(n);
+
+    const unsigned threads = std::max(4u,std::thread::hardware_concurrency());
+    std::cout << threads << " search workers, " << n << " vertices in total" << std::endl;
+    worker_time<std::allocator<char> >("std::allocator",n,threads);
+    worker_time<detail::pool_allocator<char> >("pool_allocator",n,threads);
+    worker_time<arena_allocator<char> >("per thread arena",n,threads);
+    return 0;
+}
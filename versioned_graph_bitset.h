@@ -0,0 +1,310 @@
+/***
+ * author: Damian Lipka
+ *
+ * */
+
+#ifndef VERSIONED_GRAPH_BITSET_H
+#define VERSIONED_GRAPH_BITSET_H
+#include <boost/assert.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace boost {
+
+namespace detail {
+
+typedef std::uint64_t bit_word;
+const std::size_t word_bits = 64;
+
+inline unsigned count_trailing_zeros(bit_word w){
+    BOOST_ASSERT(w!=0);
+#if defined(__GNUC__)
+    return __builtin_ctzll(w);
+#else
+    unsigned n = 0;
+    while(!(w&1)){
+        w >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+inline unsigned count_leading_zeros(bit_word w){
+    BOOST_ASSERT(w!=0);
+#if defined(__GNUC__)
+    return __builtin_clzll(w);
+#else
+    unsigned n = 0;
+    while(!(w>>(word_bits-1))){
+        w <<= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+inline unsigned count_ones(bit_word w){
+#if defined(__GNUC__)
+    return __builtin_popcountll(w);
+#else
+    unsigned n = 0;
+    for(;w;w&=w-1){
+        ++n;
+    }
+    return n;
+#endif
+}
+
+/**
+ * Set of alive elements indexed by integral descriptor,
+ * searching for next alive element skips 64 dead elements at once.
+ * Fenwick tree over counts of alive elements in words answers
+ * rank and select in O(log n) and is updated in O(log n) when bit changes.
+ * Bits above size() are always cleared.
+ */
+template<typename allocator_t = std::allocator<char> >
+class basic_alive_bitset {
+public:
+    typedef std::size_t size_type;
+
+    basic_alive_bitset() : bits(0) {}
+
+    size_type size() const{ return bits; }
+
+    bool test(size_type i) const{
+        return i<bits && ((words[i/word_bits]>>(i%word_bits))&1);
+    }
+
+    /**
+     * marks element as alive, set grows if needed
+     */
+    void set(size_type i){
+        if(i>=bits){
+            bits = i+1;
+            while(words.size()<(bits+word_bits-1)/word_bits){
+                append_word();
+            }
+        }
+        if(!test(i)){
+            words[i/word_bits] |= bit_word(1)<<(i%word_bits);
+            update(i/word_bits,1);
+        }
+    }
+
+    void reset(size_type i){
+        BOOST_ASSERT(i<bits);
+        if(test(i)){
+            words[i/word_bits] &= ~(bit_word(1)<<(i%word_bits));
+            update(i/word_bits,-1);
+        }
+    }
+
+    /**
+     * removes element, following elements are shifted down
+     * the same way as descriptors of vecS vertex list, counts are rebuilt
+     */
+    void erase(size_type i){
+        BOOST_ASSERT(i<bits);
+        size_type w = i/word_bits;
+        bit_word low = (bit_word(1)<<(i%word_bits))-1;
+        words[w] = (words[w]&low) | ((words[w]>>1)&~low);
+        for(size_type k=w+1;k<words.size();++k){
+            words[k-1] |= (words[k]&1)<<(word_bits-1);
+            words[k] >>= 1;
+        }
+        --bits;
+        words.resize((bits+word_bits-1)/word_bits);
+        rebuild();
+    }
+
+    /**
+     * first alive element not lower than i, size() if there is none
+     */
+    size_type next(size_type i) const{
+        if(i>=bits){
+            return bits;
+        }
+        size_type w = i/word_bits;
+        bit_word m = words[w] & (~bit_word(0)<<(i%word_bits));
+        while(!m){
+            if(++w==words.size()){
+                return bits;
+            }
+            m = words[w];
+        }
+        return w*word_bits+count_trailing_zeros(m);
+    }
+
+    /**
+     * last alive element lower than i, there has to be one
+     */
+    size_type prev(size_type i) const{
+        BOOST_ASSERT(i>0 && i<=bits);
+        size_type w = (i-1)/word_bits;
+        bit_word m = words[w] & (~bit_word(0)>>(word_bits-1-(i-1)%word_bits));
+        while(!m){
+            BOOST_ASSERT(w>0);
+            m = words[--w];
+        }
+        return w*word_bits+word_bits-1-count_leading_zeros(m);
+    }
+
+    /**
+     * number of alive elements
+     */
+    size_type count() const{
+        return prefix(words.size());
+    }
+
+    /**
+     * number of alive elements lower than i
+     */
+    size_type rank(size_type i) const{
+        BOOST_ASSERT(i<=bits);
+        size_type w = i/word_bits;
+        size_type n = prefix(w);
+        if(i%word_bits){
+            n += count_ones(words[w] & ((bit_word(1)<<(i%word_bits))-1));
+        }
+        return n;
+    }
+
+    /**
+     * index of n-th alive element counting from 0, size() if there is none
+     */
+    size_type select(size_type n) const{
+        // descend Fenwick tree to the word holding n-th element
+        size_type w = 0;
+        size_type step = 1;
+        while(step*2<=tree.size()){
+            step *= 2;
+        }
+        for(;step>0;step/=2){
+            if(w+step<=tree.size() && tree[w+step-1]<=n){
+                w += step;
+                n -= tree[w-1];
+            }
+        }
+        if(w==words.size()){
+            return bits;
+        }
+        bit_word m = words[w];
+        for(;n>0;--n){
+            m &= m-1;
+        }
+        return w*word_bits+count_trailing_zeros(m);
+    }
+
+private:
+    /**
+     * Fenwick tree node k (counting from 1) is stored at tree[k-1]
+     * and counts alive elements in words (k-lowbit(k),k]
+     */
+    static size_type lowbit(size_type k){
+        return k & (~k+1);
+    }
+    void update(size_type w, int delta){
+        for(size_type k=w+1;k<=tree.size();k+=lowbit(k)){
+            tree[k-1] += delta;
+        }
+    }
+    size_type prefix(size_type w) const{
+        size_type n = 0;
+        for(size_type k=w;k>0;k-=lowbit(k)){
+            n += tree[k-1];
+        }
+        return n;
+    }
+    /**
+     * appends empty word, its node sums nodes of preceding words it covers
+     */
+    void append_word(){
+        words.push_back(0);
+        size_type k = words.size();
+        size_type n = 0;
+        for(size_type j=k-1;j>k-lowbit(k);j-=lowbit(j)){
+            n += tree[j-1];
+        }
+        tree.push_back(n);
+    }
+    void rebuild(){
+        tree.assign(words.size(),0);
+        for(size_type k=1;k<=tree.size();++k){
+            tree[k-1] += count_ones(words[k-1]);
+            size_type parent = k+lowbit(k);
+            if(parent<=tree.size()){
+                tree[parent-1] += tree[k-1];
+            }
+        }
+    }
+
+    typedef typename std::allocator_traits<allocator_t>::template rebind_alloc<bit_word> word_allocator;
+    typedef typename std::allocator_traits<allocator_t>::template rebind_alloc<size_type> count_allocator;
+    std::vector<bit_word,word_allocator> words;
+    std::vector<size_type,count_allocator> tree;
+    size_type bits;
+};
+
+typedef basic_alive_bitset<> alive_bitset;
+
+/**
+ * Used instead of alive_bitset for descriptors that are not indexes
+ */
+struct no_alive_set {
+    template<typename descriptor>
+    void set(descriptor){}
+    template<typename descriptor>
+    void reset(descriptor){}
+    template<typename descriptor>
+    void erase(descriptor){}
+};
+
+/**
+ * Iterator over alive elements of basic_alive_bitset
+ */
+template<typename descriptor, typename set_type = alive_bitset>
+class alive_iterator : public boost::iterator_facade<alive_iterator<descriptor,set_type>,
+                                                     descriptor,
+                                                     boost::bidirectional_traversal_tag,
+                                                     descriptor> {
+public:
+    alive_iterator() : set(0), pos(0) {}
+    alive_iterator(const set_type* set, std::size_t pos) : set(set), pos(pos) {}
+private:
+    friend class boost::iterator_core_access;
+    descriptor dereference() const{
+        return descriptor(pos);
+    }
+    bool equal(const alive_iterator& other) const{
+        return pos==other.pos;
+    }
+    void increment(){
+        pos = set->next(pos+1);
+    }
+    void decrement(){
+        pos = set->prev(pos);
+    }
+    const set_type* set;
+    std::size_t pos;
+};
+
+/**
+ * basic_alive_bitset for integral descriptors, no_alive_set otherwise
+ */
+template<typename descriptor, typename allocator_t = std::allocator<char> >
+struct alive_set_selector {
+    typedef typename std::conditional<std::is_integral<descriptor>::value,
+                                      basic_alive_bitset<allocator_t>,
+                                      no_alive_set>::type type;
+};
+
+}
+
+}
+
+#endif // VERSIONED_GRAPH_BITSET_H
@@ -0,0 +1,135 @@
+/***
+ * author: Damian Lipka
+ *
+ * */
+
+#ifndef VERSIONED_GRAPH_FREEZE_H
+#define VERSIONED_GRAPH_FREEZE_H
+#include "versioned_graph.h"
+#include <boost/graph/compressed_sparse_row_graph.hpp>
+#include <boost/iterator/transform_iterator.hpp>
+
+namespace boost {
+
+namespace detail {
+
+/**
+ * direction of snapshot, compressed_sparse_row_graph has no undirected variant,
+ * undirected edge is stored as two directed edges
+ */
+template<typename directed_category>
+struct csr_direction {
+    typedef directedS type;
+};
+
+template<>
+struct csr_direction<bidirectional_tag> {
+    typedef bidirectionalS type;
+};
+
+/**
+ * bundle of edge of versioned graph, used as edge property iterator of snapshot
+ */
+template<typename graph_t>
+struct frozen_edge_bundle {
+    typedef const typename graph_t::edge_bundled& result_type;
+    const graph_t* g;
+    result_type operator()(const typename graph_t::edge_descriptor& e) const {
+        return (*g)[e];
+    }
+};
+
+}
+
+/**
+ * Immutable compressed_sparse_row_graph copy of not deleted vertices, edges and bundles
+ * of versioned graph, vertex i of snapshot is vertex with index i in get(vertex_index, g)
+ * at the time of freeze(), descriptors of snapshot map back to descriptors of versioned graph.
+ * Algorithms are run on graph(), snapshot of undirected graph is directed graph
+ * holding both directions of every edge.
+ */
+template<typename graph_t, typename allocator_t = detail::default_allocator>
+class frozen_graph {
+public:
+    typedef versioned_graph<graph_t,allocator_t> source_type;
+    typedef typename source_type::vertex_bundled vertex_bundled;
+    typedef typename source_type::edge_bundled edge_bundled;
+    typedef typename source_type::graph_bundled graph_bundled;
+    typedef compressed_sparse_row_graph<typename detail::csr_direction<typename source_type::directed_category>::type,
+                                        vertex_bundled,edge_bundled,graph_bundled> csr_type;
+    typedef typename graph_traits<csr_type>::vertex_descriptor vertex_descriptor;
+    typedef typename graph_traits<csr_type>::edge_descriptor edge_descriptor;
+
+    /**
+     * builds snapshot visiting every vertex and edge of g once
+     */
+    explicit frozen_graph(const source_type& g);
+
+    const csr_type& graph() const{
+        return csr;
+    }
+
+    typename source_type::vertex_descriptor original(vertex_descriptor v) const{
+        return vertex_map[v];
+    }
+    typename source_type::edge_descriptor original(edge_descriptor e) const{
+        return edge_map[get(edge_index,csr,e)];
+    }
+private:
+    void copy_vertex_bundles(const source_type& g, std::false_type){
+        for(std::size_t i=0;i<vertex_map.size();++i){
+            csr[vertex_descriptor(i)] = g[vertex_map[i]];
+        }
+    }
+    void copy_vertex_bundles(const source_type&, std::true_type){
+    }
+    template<typename iterator>
+    csr_type build(const source_type& g, iterator first, iterator last, std::false_type) const{
+        detail::frozen_edge_bundle<source_type> bundle_of = {&g};
+        return csr_type(edges_are_unsorted_multi_pass,first,last,
+                        make_transform_iterator(edge_map.begin(),bundle_of),
+                        vertex_map.size(),g[graph_bundle]);
+    }
+    template<typename iterator>
+    csr_type build(const source_type& g, iterator first, iterator last, std::true_type) const{
+        return csr_type(edges_are_unsorted_multi_pass,first,last,vertex_map.size(),g[graph_bundle]);
+    }
+
+    std::vector<typename source_type::vertex_descriptor> vertex_map; // by snapshot vertex
+    std::vector<typename source_type::edge_descriptor> edge_map; // by snapshot edge index
+    csr_type csr;
+};
+
+template<typename graph_t, typename allocator_t>
+frozen_graph<graph_t,allocator_t>::frozen_graph(const source_type& g) : vertex_map(num_vertices(g)) {
+    typename source_type::vertex_iterator vi, vi_end;
+    for(boost::tie(vi,vi_end) = vertices(g);vi!=vi_end;++vi){
+        vertex_map[g.get_index(*vi)] = *vi;
+    }
+    // edges are listed by source in snapshot order, so their order is kept by construction
+    std::vector<std::pair<std::size_t,std::size_t> > endpoints;
+    const std::size_t copies = std::is_same<typename source_type::directed_category,undirected_tag>::value ? 2 : 1;
+    endpoints.reserve(copies*num_edges(g));
+    edge_map.reserve(copies*num_edges(g));
+    for(std::size_t i=0;i<vertex_map.size();++i){
+        typename source_type::out_edge_iterator ei, ei_end;
+        for(boost::tie(ei,ei_end) = out_edges(vertex_map[i],g);ei!=ei_end;++ei){
+            endpoints.push_back(std::make_pair(i,g.get_index(target(*ei,g))));
+            edge_map.push_back(*ei);
+        }
+    }
+    csr = build(g,endpoints.begin(),endpoints.end(),std::is_same<edge_bundled,no_property>());
+    copy_vertex_bundles(g,std::is_same<vertex_bundled,no_property>());
+}
+
+/**
+ * snapshot of current state of g, see frozen_graph
+ */
+template<typename graph_t, typename allocator_t>
+frozen_graph<graph_t,allocator_t> freeze(const versioned_graph<graph_t,allocator_t>& g){
+    return frozen_graph<graph_t,allocator_t>(g);
+}
+
+}
+
+#endif // VERSIONED_GRAPH_FREEZE_H
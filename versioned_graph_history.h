@@ -0,0 +1,308 @@
+/***
+ * author: Damian Lipka
+ *
+ * */
+
+#ifndef VERSIONED_GRAPH_HISTORY_H
+#define VERSIONED_GRAPH_HISTORY_H
+#include <boost/assert.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace boost {
+
+namespace detail {
+
+/**
+ *  Reference to record of split_history, key and value are kept in separate arrays,
+ *  members have the same names as members of std::pair
+ */
+template<typename K, typename V>
+struct split_record {
+    typedef std::pair<typename std::remove_const<K>::type,typename std::remove_const<V>::type> value_type;
+
+    K& first;
+    V& second;
+
+    split_record(K& first, V& second) : first(first), second(second) {}
+    template<typename K2, typename V2>
+    split_record(const split_record<K2,V2>& other) : first(other.first), second(other.second) {}
+
+    const split_record& operator=(const value_type& value) const{
+        first = value.first;
+        second = value.second;
+        return *this;
+    }
+    operator value_type() const{
+        return value_type(first,second);
+    }
+};
+
+/**
+ *  Random access iterator over records of split_history, default constructed
+ *  iterator is null, so iterator serves also as pointer to single record
+ */
+template<typename K, typename V>
+class split_iterator : public boost::iterator_facade<split_iterator<K,V>,
+                                                     typename split_record<K,V>::value_type,
+                                                     boost::random_access_traversal_tag,
+                                                     split_record<K,V> > {
+public:
+    split_iterator() : key(0), value(0) {}
+    split_iterator(K* key, V* value) : key(key), value(value) {}
+    template<typename K2, typename V2>
+    split_iterator(const split_iterator<K2,V2>& other) : key(other.key), value(other.value) {}
+
+    explicit operator bool() const{
+        return key!=0;
+    }
+private:
+    friend class boost::iterator_core_access;
+    template<typename K2, typename V2> friend class split_iterator;
+
+    split_record<K,V> dereference() const{
+        return split_record<K,V>(*key,*value);
+    }
+    template<typename K2, typename V2>
+    bool equal(const split_iterator<K2,V2>& other) const{
+        return key==other.key;
+    }
+    void increment(){
+        ++key;
+        ++value;
+    }
+    void decrement(){
+        --key;
+        --value;
+    }
+    void advance(std::ptrdiff_t n){
+        key += n;
+        value += n;
+    }
+    template<typename K2, typename V2>
+    std::ptrdiff_t distance_to(const split_iterator<K2,V2>& other) const{
+        return other.key-key;
+    }
+
+    K* key;
+    V* value;
+};
+
+/**
+ *  History of pairs stored as two dense arrays, all keys first, then all values,
+ *  in single buffer. Scans reading only keys do not touch values and key is not padded
+ *  to alignment of value. First inline_count records are stored inside the object,
+ *  longer history is moved to heap buffer taken from stateless allocator Alloc.
+ *  Defines history interface expected by versioned_graph: stack operations, random access
+ *  from oldest record through proxy references and const_pointer returned by find_record().
+ */
+template<typename K, typename V, unsigned inline_count = 2, typename Alloc = std::allocator<char> >
+class split_history {
+    static const std::size_t alignment = std::alignment_of<K>::value > std::alignment_of<V>::value ?
+                                         std::alignment_of<K>::value : std::alignment_of<V>::value;
+    typedef typename std::aligned_storage<alignment,alignment>::type block;
+    static const std::size_t inline_bytes =
+        ((inline_count*sizeof(K)+std::alignment_of<V>::value-1)/std::alignment_of<V>::value*std::alignment_of<V>::value
+         +inline_count*sizeof(V)+alignment-1)/alignment*alignment;
+    // heap buffer is taken over, only inline records are moved one by one
+    static const bool nothrow_move = std::is_nothrow_move_constructible<K>::value &&
+                                     std::is_nothrow_move_constructible<V>::value;
+public:
+    typedef std::pair<K,V> value_type;
+    typedef typename std::allocator_traits<Alloc>::template rebind_alloc<block> allocator_type;
+    typedef std::uint32_t size_type;
+    typedef split_record<K,V> reference;
+    typedef split_record<const K,const V> const_reference;
+    typedef split_iterator<K,V> iterator;
+    typedef split_iterator<const K,const V> const_iterator;
+    typedef const_iterator const_pointer;
+
+    split_history() : keys(inline_keys()), count(0), capacity(inline_count) {}
+
+    split_history(const split_history& other) : keys(inline_keys()), count(0), capacity(inline_count) {
+        reserve(other.count);
+        std::uninitialized_copy(other.keys,other.keys+other.count,keys);
+        std::uninitialized_copy(other.values(),other.values()+other.count,values());
+        count = other.count;
+    }
+
+    split_history(split_history&& other) noexcept(nothrow_move)
+        : keys(inline_keys()), count(0), capacity(inline_count) {
+        take(other);
+    }
+
+    split_history& operator=(const split_history& other){
+        if(this!=&other){
+            split_history copy(other);
+            clear();
+            take(copy);
+        }
+        return *this;
+    }
+
+    split_history& operator=(split_history&& other) noexcept(nothrow_move){
+        if(this!=&other){
+            clear();
+            take(other);
+        }
+        return *this;
+    }
+
+    ~split_history(){
+        clear();
+    }
+
+    void push(const value_type& value){
+        if(count==capacity){
+            value_type copy(value); // value may refer to record of this history
+            grow(capacity*2);
+            construct(count,std::move(copy.first),std::move(copy.second));
+        } else {
+            construct(count,value.first,value.second);
+        }
+        ++count;
+    }
+
+    void pop(){
+        BOOST_ASSERT(count>0);
+        --count;
+        keys[count].~K();
+        values()[count].~V();
+    }
+
+    reference top(){
+        BOOST_ASSERT(count>0);
+        return reference(keys[count-1],values()[count-1]);
+    }
+    const_reference top() const{
+        BOOST_ASSERT(count>0);
+        return const_reference(keys[count-1],values()[count-1]);
+    }
+
+    reference operator[](size_type i){
+        BOOST_ASSERT(i<count);
+        return reference(keys[i],values()[i]);
+    }
+    const_reference operator[](size_type i) const{
+        BOOST_ASSERT(i<count);
+        return const_reference(keys[i],values()[i]);
+    }
+
+    iterator begin(){ return iterator(keys,values()); }
+    iterator end(){ return iterator(keys+count,values()+count); }
+    const_iterator begin() const{ return const_iterator(keys,values()); }
+    const_iterator end() const{ return const_iterator(keys+count,values()+count); }
+
+    size_type size() const{ return count; }
+    bool empty() const{ return count==0; }
+
+    /**
+     * removes all records, heap buffer is released
+     */
+    void clear(){
+        while(count>0){
+            pop();
+        }
+        if(!is_inline()){
+            allocator_type().deallocate(reinterpret_cast<block*>(keys),blocks(capacity));
+            keys = inline_keys();
+            capacity = inline_count;
+        }
+    }
+
+    void reserve(size_type n){
+        if(n>capacity){
+            grow(n);
+        }
+    }
+
+    /**
+     * bytes allocated outside of the object
+     */
+    std::size_t heap_bytes() const{
+        return is_inline() ? 0 : blocks(capacity)*sizeof(block);
+    }
+
+private:
+    static std::size_t values_offset(std::size_t n){
+        return (n*sizeof(K)+std::alignment_of<V>::value-1)/std::alignment_of<V>::value*std::alignment_of<V>::value;
+    }
+    static std::size_t blocks(std::size_t n){
+        return (values_offset(n)+n*sizeof(V)+sizeof(block)-1)/sizeof(block);
+    }
+
+    bool is_inline() const{
+        return keys==inline_keys();
+    }
+    K* inline_keys(){
+        return reinterpret_cast<K*>(&storage);
+    }
+    const K* inline_keys() const{
+        return reinterpret_cast<const K*>(&storage);
+    }
+    V* values(){
+        return reinterpret_cast<V*>(reinterpret_cast<char*>(keys)+values_offset(capacity));
+    }
+    const V* values() const{
+        return reinterpret_cast<const V*>(reinterpret_cast<const char*>(keys)+values_offset(capacity));
+    }
+
+    template<typename key_arg, typename value_arg>
+    void construct(size_type i, key_arg&& key, value_arg&& value){
+        ::new (static_cast<void*>(keys+i)) K(std::forward<key_arg>(key));
+        ::new (static_cast<void*>(values()+i)) V(std::forward<value_arg>(value));
+    }
+
+    void grow(size_type n){
+        K* buffer = reinterpret_cast<K*>(allocator_type().allocate(blocks(n)));
+        V* buffer_values = reinterpret_cast<V*>(reinterpret_cast<char*>(buffer)+values_offset(n));
+        V* old_values = values();
+        for(size_type i=0;i<count;++i){
+            ::new (static_cast<void*>(buffer+i)) K(std::move(keys[i]));
+            ::new (static_cast<void*>(buffer_values+i)) V(std::move(old_values[i]));
+            keys[i].~K();
+            old_values[i].~V();
+        }
+        if(!is_inline()){
+            allocator_type().deallocate(reinterpret_cast<block*>(keys),blocks(capacity));
+        }
+        keys = buffer;
+        capacity = n;
+    }
+
+    /**
+     * takes records of other (which has to be empty or already cleared here), other is left empty
+     */
+    void take(split_history& other){
+        if(other.is_inline()){
+            V* other_values = other.values();
+            for(size_type i=0;i<other.count;++i){
+                construct(i,std::move(other.keys[i]),std::move(other_values[i]));
+            }
+            count = other.count;
+            other.clear();
+        } else {
+            keys = other.keys;
+            count = other.count;
+            capacity = other.capacity;
+            other.keys = other.inline_keys();
+            other.count = 0;
+            other.capacity = inline_count;
+        }
+    }
+
+    typename std::aligned_storage<inline_bytes,alignment>::type storage;
+    K* keys;
+    size_type count;
+    size_type capacity;
+};
+
+}
+
+}
+
+#endif // VERSIONED_GRAPH_HISTORY_H
@@ -5,32 +5,33 @@
 
 #ifndef VERSIONED_GRAPH_IMPL_H
 #define VERSIONED_GRAPH_IMPL_H
+#include <algorithm>
 #include <iostream>
 namespace boost {
 
-template<typename graph_t>
-typename graph_traits<graph_t>::vertex_iterator versioned_graph<graph_t>::
+template<typename graph_t, typename allocator_t>
+typename graph_traits<graph_t>::vertex_iterator versioned_graph<graph_t,allocator_t>::
 vertices_begin() const {
     typename graph_traits<graph_t>::vertex_iterator iter = boost::vertices(get_base_graph()).first;
     return iter;
 }
 
-template<typename graph_t>
-typename graph_traits<graph_t>::vertex_iterator versioned_graph<graph_t>::
+template<typename graph_t, typename allocator_t>
+typename graph_traits<graph_t>::vertex_iterator versioned_graph<graph_t,allocator_t>::
 vertices_end() const {
     typename graph_traits<graph_t>::vertex_iterator iter = boost::vertices(get_base_graph()).second;
     return iter;
 }
 
-template<typename graph_t>
-typename graph_traits<graph_t>::edge_iterator versioned_graph<graph_t>::
+template<typename graph_t, typename allocator_t>
+typename graph_traits<graph_t>::edge_iterator versioned_graph<graph_t,allocator_t>::
 edges_begin() const {
     typename graph_traits<graph_t>::edge_iterator iter = boost::edges(get_base_graph()).first;
     return iter;
 }
 
-template<typename graph_t>
-typename graph_traits<graph_t>::edge_iterator versioned_graph<graph_t>::
+template<typename graph_t, typename allocator_t>
+typename graph_traits<graph_t>::edge_iterator versioned_graph<graph_t,allocator_t>::
 edges_end() const {
     typename graph_traits<graph_t>::edge_iterator iter = boost::edges(get_base_graph()).second;
     return iter;
@@ -40,13 +41,10 @@ edges_end() const {
  * Removes edge with history, operation cannot be undone
  * do not alter degree
  */
-template<typename graph_t>
-void versioned_graph<graph_t>::
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
 remove_permanently(edge_descriptor e){
-    edge_key key(e,*this);
-    auto it = edges_history.find(key);
-    assert(it!=edges_history.end());
-    edges_history.erase(it);
+    edges_history.erase(e,get_base_graph());
     remove_edge(e,get_base_graph());
 }
 
@@ -54,31 +52,30 @@ remove_permanently(edge_descriptor e){
  * Removes out_edge with history, operation cannot be undone
  * do not alter degree
  */
-template<typename graph_t>
-void versioned_graph<graph_t>::
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
 remove_permanently(out_edge_iterator iter){
-    edge_key key(*iter,*this);
-    auto it = edges_history.find(key);
-    assert(it!=edges_history.end());
-    edges_history.erase(it);
+    edges_history.erase(*iter,get_base_graph());
     remove_edge(iter.base(),get_base_graph());
 }
 
 /**
  *  implementation of boost::remove_edge()
  */
-template<typename graph_t>
-void versioned_graph<graph_t>::
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
 set_deleted(out_edge_iterator e){
-    edges_history_type hist = get_history(*e);
+    const edges_history_type& hist = get_history(*e);
     assert(!hist.empty());
     assert(!check_if_currently_deleted(*e));
     decr_degree(*e);
+    index_erase(*e);
     if(hist.size()>1 || get_latest_revision(*e) < current_rev){
         // if there are many history records or was created in older revision then mark as deleted
         mark_deleted(*e,edge_bundled());
         assert(check_if_currently_deleted(*e));
     } else {
+        forget_change(*e);
         remove_permanently(e);
     }
     --edge_count;
@@ -87,32 +84,128 @@ set_deleted(out_edge_iterator e){
 /**
  *  implementation of boost::remove_edge()
  */
-template<typename graph_t>
-void versioned_graph<graph_t>::
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
 set_deleted(edge_descriptor e){
-    edges_history_type hist = get_history(e);
+    const edges_history_type& hist = get_history(e);
     assert(!hist.empty());
     assert(!check_if_currently_deleted(e));
     decr_degree(e);
+    index_erase(e);
     if(hist.size()>1 || get_latest_revision(e) < current_rev){
         // if there are many history records or was created in older revision then mark as deleted
         mark_deleted(e,edge_bundled());
         assert(check_if_currently_deleted(e));
     } else {
+        forget_change(e);
         remove_permanently(e);
     }
     --edge_count;
 }
+template<typename graph_t, typename allocator_t>
+template<typename iterator, typename predicate>
+void versioned_graph<graph_t,allocator_t>::
+collect_edges(iterator first, iterator last, predicate pred){
+    const bool undirected = std::is_same<directed_category,boost::undirected_tag>::value;
+    for(;first!=last;++first){
+        if(!pred(*first)){
+            continue;
+        }
+        if(undirected && !edge_buffer.empty() && edge_buffer.back()==*first &&
+           source(*first,*this)==target(*first,*this)){
+            continue; // second copy of self loop follows the first one
+        }
+        edge_buffer.push_back(*first);
+    }
+}
+
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
+remove_collected_edges(){
+    for(auto e : edge_buffer){
+        set_deleted(e);
+    }
+    edge_buffer.clear();
+}
+
+template<typename graph_t, typename allocator_t>
+template<typename predicate>
+void versioned_graph<graph_t,allocator_t>::
+remove_out_edges_if(vertex_descriptor u, predicate pred){
+    auto range = out_edges(u,*this);
+    collect_edges(range.first,range.second,pred);
+    remove_collected_edges();
+}
+
+template<typename graph_t, typename allocator_t>
+template<typename predicate>
+void versioned_graph<graph_t,allocator_t>::
+remove_in_edges_if(vertex_descriptor u, predicate pred){
+    auto range = in_edges(u,*this);
+    collect_edges(range.first,range.second,pred);
+    remove_collected_edges();
+}
+
+template<typename graph_t, typename allocator_t>
+template<typename predicate>
+void versioned_graph<graph_t,allocator_t>::
+remove_edges_if(predicate pred){
+    auto range = edges(*this);
+    collect_edges(range.first,range.second,pred);
+    remove_collected_edges();
+}
+
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
+remove_incident_edges(vertex_descriptor u){
+    remove_incident_edges(u,directed_category());
+    remove_collected_edges();
+}
+
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
+remove_incident_edges(vertex_descriptor u, boost::undirected_tag){
+    auto range = out_edges(u,*this);
+    collect_edges(range.first,range.second,[](edge_descriptor){ return true; });
+}
+
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
+remove_incident_edges(vertex_descriptor u, boost::bidirectional_tag){
+    auto out_range = out_edges(u,*this);
+    collect_edges(out_range.first,out_range.second,[](edge_descriptor){ return true; });
+    // self loops are already collected as out edges
+    auto in_range = in_edges(u,*this);
+    collect_edges(in_range.first,in_range.second,[&](edge_descriptor e){ return source(e,*this)!=u; });
+}
+
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
+remove_incident_edges(vertex_descriptor u, boost::directed_tag){
+    auto out_range = out_edges(u,*this);
+    collect_edges(out_range.first,out_range.second,[](edge_descriptor){ return true; });
+    // in edges are not stored, out edges of other vertices are checked
+    vertex_iterator vi, vi_end;
+    for(boost::tie(vi,vi_end) = vertices(*this);vi!=vi_end;++vi){
+        if(*vi==u){
+            continue;
+        }
+        auto range = out_edges(*vi,*this);
+        collect_edges(range.first,range.second,[&](edge_descriptor e){ return target(e,*this)==u; });
+    }
+}
+
 /**
  *  Removes vertex with history, operation cannot be undone
  */
-template<typename graph_t>
-void versioned_graph<graph_t>::
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
 remove_permanently(vertex_descriptor v){
     auto it = vertices_history.find(v);
     assert(it!=vertices_history.end());
     vertices_history.erase(it);
-    assert(!versioned_graph<graph_t>::non_removable_vertex::value && "vertex descriptors invalidated");
+    alive_vertices.erase(v);
+    assert(!self_type::non_removable_vertex::value && "vertex descriptors invalidated");
     assert(!vertices_history.empty());
     remove_vertex(v,get_base_graph());
 }
@@ -120,11 +213,13 @@ remove_permanently(vertex_descriptor v){
 /**
  *  implementation of boost::remove_vertex()
  */
-template<typename graph_t>
-void versioned_graph<graph_t>::
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
 set_deleted(vertex_descriptor v){
+    index_erase(v);
     if(get_history(v).size()>1 || get_latest_revision(v) < current_rev){
         mark_deleted(v,vertex_bundled());
+        alive_vertices.reset(v);
         assert(check_if_currently_deleted(v));
     } else {
         remove_permanently(v);
@@ -135,8 +230,8 @@ set_deleted(vertex_descriptor v){
 /**
  * decrement out_degree and in_degree of graph
  */
-template<typename graph_t>
-void versioned_graph<graph_t>::
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
 decr_degree(edge_descriptor e){
     vertex_descriptor u = boost::source(e,*this);
     vertex_descriptor v = boost::target(e,*this);
@@ -150,8 +245,8 @@ decr_degree(edge_descriptor e){
 /**
  * increment out_degree and in_degree of graph
  */
-template<typename graph_t>
-void versioned_graph<graph_t>::
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
 incr_degree(edge_descriptor e){
     vertex_descriptor u = boost::source(e,*this);
     vertex_descriptor v = boost::target(e,*this);
@@ -167,14 +262,15 @@ incr_degree(edge_descriptor e){
  * if removed record made edge marked as deleted adjusts num_edges() result
  * do not alter edge attributes
  */
-template<typename graph_t>
-void versioned_graph<graph_t>::
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
 clean_history( edges_history_type& hist, edge_descriptor desc){
     revision r = detail::get_revision(hist.top());
     hist.pop();
     if(is_deleted(r)){
         ++edge_count;
         incr_degree(desc);
+        index_insert(desc);
     }
 }
 
@@ -183,81 +279,205 @@ clean_history( edges_history_type& hist, edge_descriptor desc){
  * if removed record made vertex marked as deleted adjusts num_vertices() result
  * do not alter vertex attributes
  */
-template<typename graph_t>
-void versioned_graph<graph_t>::
-clean_history( vertices_history_type& hist){
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
+clean_history( vertices_history_type& hist, vertex_descriptor desc){
     revision rev_num = detail::get_revision(hist.top());
     if (is_deleted(rev_num)) {
        ++vertex_count;
+       alive_vertices.set(desc);
+       index_insert(desc);
        // vertex was marked as deleted, now will exist
     }
     hist.pop();
 }
 
-template<typename graph_t>
-void versioned_graph<graph_t>::
+template<typename graph_t, typename allocator_t>
+bool versioned_graph<graph_t,allocator_t>::
+clean_to_current_rev(edge_descriptor e){
+    edges_history_type& hist = get_history(e);
+    while(!hist.empty() && get_latest_revision(e)>=current_rev){
+        clean_history(hist,e);
+    }
+    if(hist.empty()){
+        return false;
+    }
+    get_base_graph()[e] = property_handler<self_type,edge_descriptor,edge_bundled>::get_latest_bundled_value(e,*this);
+    return true;
+}
+
+template<typename graph_t, typename allocator_t>
+bool versioned_graph<graph_t,allocator_t>::
+clean_to_current_rev(vertex_descriptor v){
+    vertices_history_type& hist = get_history(v);
+    while(!hist.empty() && get_latest_revision(v)>=current_rev){
+        clean_history(hist,v);
+    }
+    if(hist.empty()){
+        // vertex was created in this or younger revision, we need to delete it
+        return false;
+    }
+    get_base_graph()[v] = property_handler<self_type,vertex_descriptor,vertex_bundled>::get_latest_bundled_value(v,*this);
+    return true;
+}
+
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
+remove_created(edge_descriptor e){
+    decr_degree(e);
+    index_erase(e);
+    remove_permanently(e);
+    --edge_count;
+}
+
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
+remove_created(vertex_descriptor v){
+    index_erase(v);
+    remove_permanently(v);
+    --vertex_count;
+    // completly removed vertex history record
+}
+
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
+rollback_edges(const changes_type& changes, edge_list& will_remove){
+    // descriptors of removed elements stay in changes, skip them
+    for(auto it = changes.edges.rbegin(); it != changes.edges.rend(); ++it){
+        edge_stored_data* data = edges_history.find(*it,get_base_graph());
+        if(!data || data->dirty){
+            continue;
+        }
+        data->dirty = true;
+        if(!clean_to_current_rev(*it)){
+            will_remove.push_back(*it);
+        }
+    }
+}
+
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
+rollback_vertices(const changes_type& changes){
+    for(auto it = changes.vertices.rbegin(); it != changes.vertices.rend(); ++it){
+        auto iter = vertices_history.find(*it);
+        if(iter==vertices_history.end() || iter->second.dirty){
+            continue;
+        }
+        iter->second.dirty = true;
+        if(!clean_to_current_rev(*it)){
+            remove_created(*it);
+        }
+    }
+}
+
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
+rollback(std::size_t first){
+    assert(current_rev > detail::revision::create_start());
+    assert(first<=committed_changes.size());
+    // element may be recorded in many revisions, dirty flag marks already cleaned ones
+    reset_dirty_flags(dirty);
+    edge_list will_remove;
+    rollback_edges(dirty,will_remove);
+    for(auto i = committed_changes.size(); i > first; --i){
+        rollback_edges(committed_changes[i-1],will_remove);
+    }
+    // older changes may still refer to created edges, remove them when no longer visited
+    reset_edge_flags(dirty);
+    for(auto i = committed_changes.size(); i > first; --i){
+        reset_edge_flags(committed_changes[i-1]);
+    }
+    for(auto e : will_remove){
+        remove_created(e);
+    }
+    rollback_vertices(dirty);
+    for(auto i = committed_changes.size(); i > first; --i){
+        rollback_vertices(committed_changes[i-1]);
+    }
+    reset_vertex_flags(dirty);
+    for(auto i = committed_changes.size(); i > first; --i){
+        reset_vertex_flags(committed_changes[i-1]);
+    }
+    dirty.clear();
+    committed_changes.resize(first);
+}
+
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
 clean_edges_to_current_rev(){
     assert(current_rev > detail::revision::create_start());
-    typename graph_traits<graph_t>::edge_iterator ei, ei_end, next;
+    typename graph_traits<graph_t>::edge_iterator ei, ei_end;
     boost::tie(ei,ei_end) = boost::edges(get_base_graph());
     std::deque<edge_descriptor> will_remove;
-    for (next = ei; ei != ei_end; ei = next) {
-        ++next;
-        edge_descriptor e =  *ei;
-        edges_history_type& hist = get_history(e);
-        while(!hist.empty() && get_latest_revision(e)>=current_rev){
-            clean_history(hist,e);
-        }
-        if(hist.empty()){
-            will_remove.push_back(e);
-        } else {
-            (*this)[e] = property_handler<self_type,edge_descriptor,edge_bundled>::get_latest_bundled_value(e,*this);
+    for (; ei != ei_end; ++ei) {
+        if(!clean_to_current_rev(*ei)){
+            will_remove.push_back(*ei);
         }
     }
     for(auto e : will_remove){
-        decr_degree(e);
-        remove_permanently(e);
-        --edge_count;
+        remove_created(e);
     }
 }
 
-template<typename graph_t>
-void versioned_graph<graph_t>::
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
 clean_vertices_to_current_rev(){
     assert(current_rev > detail::revision::create_start());
-    typename graph_traits<graph_t>::vertex_iterator vi, vi_end, next;
+    typename graph_traits<graph_t>::vertex_iterator vi, vi_end;
     std::deque<vertex_descriptor> will_remove;
     boost::tie(vi, vi_end) = vertices(get_base_graph());
-    for (next = vi; vi != vi_end; vi = next) {
-        ++next;
-        vertex_descriptor v = *vi;
-        vertices_history_type& hist = get_history(v);
-        while(!hist.empty() && get_latest_revision(v)>=current_rev){
-            clean_history(hist);
-        }
-        if(hist.empty()){
-            // vertex was created in this or younger revision, we need to delete it
-            will_remove.push_back(v);
-        } else {
-            (*this)[v] = property_handler<self_type,vertex_descriptor,vertex_bundled>::get_latest_bundled_value(v,*this);
+    for (; vi != vi_end; ++vi) {
+        if(!clean_to_current_rev(*vi)){
+            will_remove.push_back(*vi);
         }
     }
     for(auto v : will_remove){
-        remove_permanently(v);
-        --vertex_count;
-        // completly removed vertex history record
+        remove_created(v);
+    }
+}
+
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
+reset_dirty_flags(const changes_type& changes){
+    reset_edge_flags(changes);
+    reset_vertex_flags(changes);
+}
+
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
+reset_edge_flags(const changes_type& changes){
+    for(auto e : changes.edges){
+        edge_stored_data* data = edges_history.find(e,get_base_graph());
+        if(data){
+            data->dirty = false;
+        }
+    }
+}
+
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
+reset_vertex_flags(const changes_type& changes){
+    for(auto v : changes.vertices){
+        auto iter = vertices_history.find(v);
+        if(iter!=vertices_history.end()){
+            iter->second.dirty = false;
+        }
     }
 }
 
-template<typename graph_t>
-versioned_graph<graph_t>::
+template<typename graph_t, typename allocator_t>
+versioned_graph<graph_t,allocator_t>::
 versioned_graph(const versioned_graph& g ) : direct_base(0),
                                              graph_bundled_history(g.graph_bundled_history),
+                                             graph_bundle_dirty(g.graph_bundle_dirty),
                                              vertex_count(g.vertex_count),
                                              edge_count(g.edge_count),
                                              current_rev(g.current_rev)
                                              {
-    std::map<vertex_descriptor,vertex_descriptor> vertex_map;
+    typedef typename detail::rebind_allocator<allocator_t,std::pair<const vertex_descriptor,vertex_descriptor> >::type vertex_map_allocator;
+    typedef typename detail::rebind_allocator<allocator_t,std::pair<const edge_key,edge_descriptor> >::type edge_map_allocator;
+    std::map<vertex_descriptor,vertex_descriptor,std::less<vertex_descriptor>,vertex_map_allocator> vertex_map;
+    std::unordered_map<edge_key,edge_descriptor,std::hash<edge_key>,std::equal_to<edge_key>,edge_map_allocator> edge_map;
 
     // Copy the stored vertex objects by adding each vertex
     // and copying its bundled property object.
@@ -268,9 +488,10 @@ versioned_graph(const versioned_graph& g ) : direct_base(0),
       auto iter = g.vertices_history.find(*vi);
       assert(iter!=g.vertices_history.end());
       vertices_history.insert(std::make_pair(v,iter->second));
-      (*this)[v] = g[*vi]; // set bundled properties
+      get_base_graph()[v] = g[*vi]; // set bundled properties
       if(!detail::is_deleted(detail::get_revision(iter->second.hist.top()))){
           ++v_count;
+          alive_vertices.set(v);
           // vertex marked as existing, so increase num_edges()
       }
       vertex_map[*vi] = v;
@@ -287,21 +508,48 @@ versioned_graph(const versioned_graph& g ) : direct_base(0),
       boost::tie(e, inserted) = add_edge(vertex_map[s],
                                          vertex_map[t], get_base_graph());
       assert(inserted);
-      auto key = edge_key(*ei,g);
-      auto iter = g.edges_history.find(key);
-      assert(iter!=g.edges_history.end());
-      auto newkey = edge_key(e,*this);
-      edges_history.insert(std::make_pair(newkey,iter->second));
-      (*this)[e] = g[key]; // set bundled properties
-
-      revision r = detail::get_revision(iter->second.top());
+      const edge_stored_data& data = g.get_stored_data(*ei);
+      edges_history.insert(e,get_base_graph(),data);
+      get_base_graph()[e] = g[*ei]; // set bundled properties
+      edge_map.insert(std::make_pair(g.get_edge_key(*ei),e));
+
+      revision r = detail::get_revision(data.hist.top());
       if(!is_deleted(r)){
           ++e_count;
           // edge marked as existing, so increase num_edges()
       }
     }
     // copy graph property
-    (*this)[graph_bundle] = g[graph_bundle];
+    get_base_graph()[graph_bundle] = g[graph_bundle];
+
+    // copy index of changes, descriptors of already removed elements are skipped
+    auto translate = [&](const changes_type& from, changes_type& to){
+        for(auto v : from.vertices){
+            auto iter = vertex_map.find(v);
+            if(iter!=vertex_map.end()){
+                to.vertices.push_back(iter->second);
+            }
+        }
+        for(auto e : from.edges){
+            auto iter = edge_map.find(g.get_edge_key(e));
+            if(iter!=edge_map.end()){
+                to.edges.push_back(iter->second);
+            }
+        }
+    };
+    indexed_vertices.reserve(g.indexed_vertices.size());
+    for(auto v : g.indexed_vertices){
+        indexed_vertices.push_back(vertex_map[v]);
+    }
+    indexed_edges.reserve(g.indexed_edges.size());
+    for(auto e : g.indexed_edges){
+        indexed_edges.push_back(edge_map[g.get_edge_key(e)]);
+    }
+    translate(g.dirty,dirty);
+    committed_changes.resize(g.committed_changes.size());
+    for(std::size_t i = 0; i < g.committed_changes.size(); ++i){
+        translate(g.committed_changes[i],committed_changes[i]);
+    }
 
     BOOST_ASSERT_MSG(e_count==edge_count,("counted " + std::to_string(e_count) + "  edges while expected " + std::to_string(edge_count)).c_str());
     assert(boost::num_vertices(get_base_graph())==vertices_history.size());
@@ -310,85 +558,119 @@ versioned_graph(const versioned_graph& g ) : direct_base(0),
 /**
  *  init history structure for new vertex
  */
-template<typename graph_t>
-void versioned_graph<graph_t>::init(vertex_descriptor v,const vertex_bundled& prop){
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::init(vertex_descriptor v,const vertex_bundled& prop){
     vertices_history.insert(std::make_pair(v,vertex_stored_data()));
     vertices_history_type& list = get_history(v);
     assert(list.empty());
     list.push(detail::make_entry(current_rev,prop));
+    alive_vertices.set(v);
+    index_insert(v);
+    mark_dirty(v);
 }
 
 /**
  *  init history structure for new edge
  */
-template<typename graph_t>
-void versioned_graph<graph_t>::init(edge_descriptor e,const edge_bundled& prop){
-    edge_key key(e,*this);
-    if(edges_history.find(key)==edges_history.end()){
-        edges_history.insert(std::make_pair(key,edges_history_type()));
-    }
-    edges_history_type& list = get_history(e);
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::init(edge_descriptor e,const edge_bundled& prop){
+    edges_history_type& list = edges_history.insert(e,get_base_graph(),edge_stored_data()).hist;
     assert(list.empty());
     list.push(detail::make_entry(current_rev,prop));
     incr_degree(e);
+    index_insert(e);
+    mark_dirty(e);
 }
 
-template<typename graph_t>
-typename versioned_graph<graph_t>::vertex_descriptor
-versioned_graph<graph_t>::generate_vertex(vertex_bundled prop){
+template<typename graph_t, typename allocator_t>
+typename versioned_graph<graph_t,allocator_t>::vertex_descriptor
+versioned_graph<graph_t,allocator_t>::generate_vertex(vertex_bundled prop){
     using namespace detail;
     vertex_descriptor v = boost::add_vertex(get_base_graph());
-    (*this)[v] = prop;
-    init(v);
+    get_base_graph()[v] = prop;
+    init(v,prop);
     ++vertex_count;
     return v;
 }
 
-template<typename graph_t>
-std::pair<typename versioned_graph<graph_t>::edge_descriptor,bool>
-versioned_graph<graph_t>::
+template<typename graph_t, typename allocator_t>
+std::pair<typename versioned_graph<graph_t,allocator_t>::edge_descriptor,bool>
+versioned_graph<graph_t,allocator_t>::
 generate_edge(edge_bundled prop,vertex_descriptor u, vertex_descriptor v){
     using namespace detail;
-    auto p = boost::add_edge(u,v,prop,get_base_graph());
+    auto p = boost::add_edge(u,v,edges_history.make_property(prop),get_base_graph());
     if(p.second){
-        auto key = edge_key(p.first,*this);
-        init(key,prop);
+        init(p.first,prop);
         ++edge_count;
     }
     return p;
 }
 
-template<typename graph_t>
-void versioned_graph<graph_t>::commit(){
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::commit(){
     using namespace detail;
-    auto ei = edges(*this);
-    // copy properties from graph to history
-    for(auto edge_iter = ei.first; edge_iter != ei.second; ++edge_iter) {
-        edges_history_type& hist = get_history(*edge_iter);
-        edge_bundled prop = (*this)[*edge_iter];
-        if(hist.empty() || property_handler<self_type,edge_descriptor,edge_bundled>::is_update_needed(*edge_iter,*this,prop)){
-            hist.push(make_entry(current_rev,prop));
+    if(current_rev==revision::create_max()){
+        throw revision_overflow();
+    }
+    // copy properties of modified elements from graph to history,
+    // elements with record in this revision are kept in committed_changes
+    auto e_out = dirty.edges.begin();
+    for(auto e : dirty.edges){
+        edge_stored_data* data = edges_history.find(e,get_base_graph());
+        if(!data || !data->dirty){
+            continue; // removed permanently or already visited
+        }
+        data->dirty = false;
+        edges_history_type& hist = data->hist;
+        const edge_bundled& prop = get_base_graph()[e];
+        if(!is_deleted(get_revision(hist.top()))){
+            store_entry(hist,current_rev,prop);
+        }
+        if(get_revision(hist.top())>=current_rev){
+            *e_out++ = e;
         }
     }
-    auto vi = boost::vertices(*this);
-    for(auto vertex_iter = vi.first; vertex_iter != vi.second; ++vertex_iter) {
-        vertices_history_type& hist = get_history(*vertex_iter);
-        vertex_bundled prop = (*this)[*vertex_iter];
-        if(hist.empty() || property_handler<self_type,vertex_descriptor,vertex_bundled>::is_update_needed(*vertex_iter,*this,prop)){
-            hist.push(make_entry(current_rev,prop));
+    dirty.edges.erase(e_out,dirty.edges.end());
+    auto v_out = dirty.vertices.begin();
+    for(auto v : dirty.vertices){
+        auto iter = vertices_history.find(v);
+        if(iter==vertices_history.end() || !iter->second.dirty){
+            continue; // removed permanently or already visited
+        }
+        iter->second.dirty = false;
+        vertices_history_type& hist = iter->second.hist;
+        const vertex_bundled& prop = get_base_graph()[v];
+        if(!is_deleted(get_revision(hist.top()))){
+            store_entry(hist,current_rev,prop);
+        }
+        if(get_revision(hist.top())>=current_rev){
+            *v_out++ = v;
         }
     }
-    graph_bundled_history.update_if_needed(current_rev,(*this)[graph_bundle]);
+    dirty.vertices.erase(v_out,dirty.vertices.end());
+    committed_changes.push_back(std::move(dirty));
+    dirty = changes_type();
+    if(graph_bundle_dirty || graph_bundled_history.empty()){
+        graph_bundled_history.update_if_needed(current_rev,get_base_graph()[graph_bundle]);
+        graph_bundle_dirty = false;
+    }
     ++current_rev;
+    if(!observers.empty()){
+        const revision committed = revision::create(current_rev.get_rev()-1);
+        change_batch_type batch(change_batch_type::commit_operation,committed);
+        static_cast<diff_type&>(batch) = get_diff(revision::create(committed.get_rev()-1),committed);
+        notify(batch);
+    }
 }
 
 /**
  * delete all history records and creates single new record for
  * latest graph property, each vertex and each edge, cannnot undo this operation
  */
-template<typename graph_t>
-void versioned_graph<graph_t>::erase_history(){
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::erase_history(){
     using namespace detail;
+    reset_dirty_flags(dirty); // before edges referred by changes are removed
     {
         auto ei = edges(get_base_graph());
         for(auto edge_iter = ei.first; edge_iter != ei.second; ) {
@@ -398,7 +680,7 @@ void versioned_graph<graph_t>::erase_history(){
                 hist.pop(); // clear history
             }
             // recreate single entry
-            hist.push(make_entry(revision::create_start(),(*this)[*edge_iter]));
+            hist.push(make_entry(revision::create_start(),get_base_graph()[*edge_iter]));
             assert(get_latest_revision(*edge_iter)==revision::create_start());
             if(is_deleted(old_rev)){ // edges marked as deleted,m should not exist after erasing history
                 auto old = edge_iter;
@@ -410,14 +692,14 @@ void versioned_graph<graph_t>::erase_history(){
         }
     }
     auto vi = boost::vertices(get_base_graph());
-    for(auto vertex_iter = vi.first; vertex_iter != vi.second; ++vertex_iter) {
+    for(auto vertex_iter = vi.first; vertex_iter != vi.second; ) {
         vertices_history_type& hist = get_history(*vertex_iter);
         const revision old_rev = get_latest_revision(*vertex_iter);
         while(!hist.empty()){
             hist.pop(); // clear history
         }
         // recreate single entry
-        hist.push(make_entry(revision::create_start(),(*this)[*vertex_iter]));
+        hist.push(make_entry(revision::create_start(),get_base_graph()[*vertex_iter]));
         assert(get_latest_revision(*vertex_iter)==revision::create_start());
         if(is_deleted(old_rev)){ // vertices marked as deleted,m should not exist after erasing history
             auto old = vertex_iter;
@@ -428,19 +710,116 @@ void versioned_graph<graph_t>::erase_history(){
         }
     }
     graph_bundled_history.clear();
+    graph_bundle_dirty = false;
+    dirty.clear();
+    committed_changes.clear();
     current_rev = revision::create_start();
+    // surviving elements are recorded in the first revision, so diff() and observers see them
+    typename graph_traits<graph_t>::vertex_iterator v_it, v_end;
+    for(boost::tie(v_it,v_end) = boost::vertices(get_base_graph()); v_it != v_end; ++v_it){
+        mark_dirty(*v_it);
+    }
+    typename graph_traits<graph_t>::edge_iterator e_it, e_end;
+    for(boost::tie(e_it,e_end) = boost::edges(get_base_graph()); e_it != e_end; ++e_it){
+        mark_dirty(*e_it);
+    }
 }
 
-template<typename graph_t>
-void versioned_graph<graph_t>::
+/**
+ * restores state of last commit, only elements touched
+ * since then are visited
+ */
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
+revert_uncommited(){
+    rollback(committed_changes.size());
+    if(graph_bundle_dirty){
+        get_base_graph()[graph_bundle] = graph_bundled_history.get_latest();
+        graph_bundle_dirty = false;
+    }
+    if(!observers.empty()){
+        notify(change_batch_type(change_batch_type::revert_operation,revision::create(current_rev.get_rev()-1)));
+    }
+}
+
+template<typename graph_t, typename allocator_t>
+typename versioned_graph<graph_t,allocator_t>::diff_type
+versioned_graph<graph_t,allocator_t>::
+get_diff(revision from, revision to) const{
+    assert(from<=to && to<current_rev);
+    diff_type result;
+    for(auto r = from.get_rev()+1; r <= to.get_rev(); ++r){
+        const changes_type& changes = committed_changes[r-1];
+        for(auto v : changes.vertices){
+            auto iter = vertices_history.find(v);
+            if(iter!=vertices_history.end()){
+                classify_change(result,v,iter->second.hist,from,to,revision::create(r));
+            }
+        }
+        for(auto e : changes.edges){
+            const edge_stored_data* data = edges_history.find(e,get_base_graph());
+            if(data){
+                classify_change(result,e,data->hist,from,to,revision::create(r));
+            }
+        }
+    }
+    result.graph_bundle_modified = graph_bundled_history.changed_between(from,to);
+    return result;
+}
+
+template<typename graph_t, typename allocator_t>
+template<typename descriptor,typename history_type>
+void versioned_graph<graph_t,allocator_t>::
+classify_change(diff_type& result, descriptor d, const history_type& hist,
+                revision from, revision to, revision r){
+    using namespace detail;
+    auto range = records_between(hist,revision::create(from.get_rev()+1),to);
+    if(range.first==range.second || !(get_revision(*range.first)==r)){
+        return;
+    }
+    auto before = find_record(hist,from);
+    const auto& after = *(range.second-1);
+    bool existed = before && !is_deleted(get_revision(*before));
+    bool exists = !is_deleted(get_revision(after));
+    if(!existed && exists){
+        result.added.push(d);
+    } else if(existed && !exists){
+        result.removed.push(d);
+    } else if(existed && is_update_needed(*before,get_value(after))){
+        result.modified.push(d);
+    }
+}
+
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
 undo_commit(){
-    if(current_rev.get_rev()>2){
-        --current_rev;
+    assert(current_rev > detail::revision::create_start());
+    undo_to(revision::create(current_rev.get_rev()-2));
+}
+
+template<typename graph_t, typename allocator_t>
+void versioned_graph<graph_t,allocator_t>::
+undo_to(revision rev){
+    assert(current_rev > detail::revision::create_start());
+    const revision restored = rev.get_rev()<1 ? revision::create_start() : revision::create(rev.get_rev());
+    assert(restored<current_rev);
+    change_batch_type batch(change_batch_type::undo_operation,restored);
+    if(!observers.empty()){
+        // undone revisions are read before their records are removed, in reverse
+        diff_type undone = get_diff(restored,revision::create(current_rev.get_rev()-1));
+        batch.removed = std::move(undone.added);
+        batch.resurrected = std::move(undone.removed);
+        batch.modified = std::move(undone.modified);
+        batch.graph_bundle_modified = undone.graph_bundle_modified;
     }
-    clean_edges_to_current_rev();
-    clean_vertices_to_current_rev();
+    current_rev = revision::create(restored.get_rev()+1);
+    rollback(restored.get_rev());
     graph_bundled_history.clean_to_max(current_rev);
-    (*this)[graph_bundle] = graph_bundled_history.get_latest();
+    get_base_graph()[graph_bundle] = graph_bundled_history.get_latest();
+    graph_bundle_dirty = false;
+    if(!observers.empty()){
+        notify(batch);
+    }
 }
 
 }
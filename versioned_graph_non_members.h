@@ -5,137 +5,93 @@
 
 #ifndef VERSIONED_GRAPH_NON_MEMBERS_H
 #define VERSIONED_GRAPH_NON_MEMBERS_H
-#include <list>
 
 namespace boost {
 
-template<typename graph_t>
-typename versioned_graph<graph_t>::vertex_descriptor
-add_vertex(versioned_graph<graph_t>& g){
-    typedef typename versioned_graph<graph_t>::vertex_bundled bundled_type;
+template<typename graph_t, typename allocator_t>
+typename versioned_graph<graph_t,allocator_t>::vertex_descriptor
+add_vertex(versioned_graph<graph_t,allocator_t>& g){
+    typedef typename versioned_graph<graph_t,allocator_t>::vertex_bundled bundled_type;
     return g.generate_vertex(bundled_type());
 }
 
-template<typename graph_t, typename propertyType>
-typename versioned_graph<graph_t>::vertex_descriptor
-add_vertex(const propertyType& p, versioned_graph<graph_t>& g){
+template<typename graph_t, typename allocator_t, typename propertyType>
+typename versioned_graph<graph_t,allocator_t>::vertex_descriptor
+add_vertex(const propertyType& p, versioned_graph<graph_t,allocator_t>& g){
     return g.generate_vertex(p);
 }
 
-template<typename graph_t, typename vertex_descriptor, typename propertyType>
-std::pair<typename versioned_graph<graph_t>::edge_descriptor,bool>
-add_edge(vertex_descriptor u,vertex_descriptor v,const propertyType& p, versioned_graph<graph_t>& g){
+template<typename graph_t, typename allocator_t, typename vertex_descriptor, typename propertyType>
+std::pair<typename versioned_graph<graph_t,allocator_t>::edge_descriptor,bool>
+add_edge(vertex_descriptor u,vertex_descriptor v,const propertyType& p, versioned_graph<graph_t,allocator_t>& g){
     return g.generate_edge(p,u,v);
 }
 
-template<typename graph_t,typename vertex_descriptor>
-std::pair<typename versioned_graph<graph_t>::edge_descriptor,bool>
-add_edge(vertex_descriptor u,vertex_descriptor v, versioned_graph<graph_t>& g){
-    typedef typename versioned_graph<graph_t>::edge_bundled bundled_type;
+template<typename graph_t, typename allocator_t,typename vertex_descriptor>
+std::pair<typename versioned_graph<graph_t,allocator_t>::edge_descriptor,bool>
+add_edge(vertex_descriptor u,vertex_descriptor v, versioned_graph<graph_t,allocator_t>& g){
+    typedef typename versioned_graph<graph_t,allocator_t>::edge_bundled bundled_type;
     return g.generate_edge(bundled_type(),u,v);
 }
 
-template<typename graph_t,typename vertex_descriptor>
-std::pair<typename versioned_graph<graph_t>::edge_descriptor,bool>
-edge(vertex_descriptor u,vertex_descriptor v, const versioned_graph<graph_t>& g) {
-    using namespace detail;
-    typedef versioned_graph<graph_t> graph_type;
-    typename graph_type::out_edge_iterator it,end;
-    tie(it,end) = out_edges(u,g);
-    while(it!=end){
-        if(target(*it,g)==v){
-            return std::make_pair(*it,true);
-        }
-        ++it;
-    }
-    return std::make_pair(typename graph_type::edge_descriptor(),false);
-}
-
-template<typename graph_t>
-std::pair<typename versioned_graph<graph_t>::edge_iterator,
-          typename versioned_graph<graph_t>::edge_iterator>
-edges(const versioned_graph<graph_t>& g){
-    typedef versioned_graph<graph_t> graph_type;
+template<typename graph_t, typename allocator_t,typename vertex_descriptor>
+std::pair<typename versioned_graph<graph_t,allocator_t>::edge_descriptor,bool>
+edge(vertex_descriptor u,vertex_descriptor v, const versioned_graph<graph_t,allocator_t>& g) {
+    return g.get_edge(u,v);
+}
+
+template<typename graph_t, typename allocator_t>
+std::pair<typename versioned_graph<graph_t,allocator_t>::edge_iterator,
+          typename versioned_graph<graph_t,allocator_t>::edge_iterator>
+edges(const versioned_graph<graph_t,allocator_t>& g){
+    typedef versioned_graph<graph_t,allocator_t> graph_type;
     typename graph_type::edge_predicate predicate(&g);
     typename graph_type::edge_iterator iter_begin(predicate, g.edges_begin(), g.edges_end());
     typename graph_type::edge_iterator iter_end(predicate, g.edges_end(), g.edges_end());
     return std::make_pair(iter_begin,iter_end);
 }
 
-template<typename graph_t>
-std::pair<typename versioned_graph<graph_t>::vertex_iterator,
-          typename versioned_graph<graph_t>::vertex_iterator>
-vertices(const versioned_graph<graph_t>& g){
-    typedef versioned_graph<graph_t> graph_type;
+template<typename graph_t, typename allocator_t>
+std::pair<typename versioned_graph<graph_t,allocator_t>::vertex_iterator,
+          typename versioned_graph<graph_t,allocator_t>::vertex_iterator>
+vertices(const versioned_graph<graph_t,allocator_t>& g){
+    return g.get_vertices();
+}
 
-    typename graph_type::vertex_predicate predicate(&g);
-    auto end = g.vertices_end();
-    typename graph_type::vertex_iterator iter_begin(predicate, g.vertices_begin(), end);
-    typename graph_type::vertex_iterator iter_end(predicate, end, end);
-    return std::make_pair(iter_begin,iter_end);
+template<typename graph_t, typename allocator_t,typename vertex_descriptor>
+void clear_out_edges(vertex_descriptor u, versioned_graph<graph_t,allocator_t>& g){
+    typedef typename versioned_graph<graph_t,allocator_t>::edge_descriptor edge_descriptor;
+    g.remove_out_edges_if(u,[](edge_descriptor){ return true; });
+}
+
+template<typename graph_t, typename allocator_t,typename vertex_descriptor>
+void clear_in_edges(vertex_descriptor u, versioned_graph<graph_t,allocator_t>& g){
+    typedef typename versioned_graph<graph_t,allocator_t>::edge_descriptor edge_descriptor;
+    g.remove_in_edges_if(u,[](edge_descriptor){ return true; });
+}
+
+template<typename graph_t, typename allocator_t, typename vertex_descriptor>
+void clear_vertex(vertex_descriptor u, versioned_graph<graph_t,allocator_t>& g){
+    g.remove_incident_edges(u);
 }
 
-template<typename graph_t,typename vertex_descriptor>
-void clear_out_edges(vertex_descriptor u, versioned_graph<graph_t>& g){
-    typedef versioned_graph<graph_t> graph_type;
-    typedef typename graph_type::out_edge_iterator out_edge_iterator;
-    out_edge_iterator ei, ei_end;
-    tie(ei, ei_end) = out_edges(u,g);
-    std::list<typename graph_type::edge_descriptor> to_remove;
-    copy(ei, ei_end, std::back_inserter(to_remove));
-    for(auto e : to_remove){
-        g.set_deleted(e);
-    }
-}
-
-template<typename graph_t,typename vertex_descriptor>
-void clear_in_edges(vertex_descriptor u, versioned_graph<graph_t>& g){
-    typedef versioned_graph<graph_t> graph_type;
-    typedef typename graph_type::in_edge_iterator in_edge_iterator;
-    in_edge_iterator ei, ei_end;
-    boost::tie(ei, ei_end) = in_edges(u,g);
-    std::list<typename graph_type::edge_descriptor> to_remove;
-    copy(ei, ei_end, std::back_inserter(to_remove));
-    for(auto e : to_remove){
-        g.set_deleted(e);
-    }
-}
-
-template<typename graph_t, typename vertex_descriptor>
-void clear_vertex(vertex_descriptor u, versioned_graph<graph_t>& g){
-    typedef versioned_graph<graph_t> graph_type;
-    typedef typename graph_type::edge_iterator edge_iterator;
-    edge_iterator ei, ei_end, next;
-    std::list<typename graph_type::edge_descriptor> to_remove;
-    boost::tie(ei, ei_end) = edges(g);
-    for (next = ei; ei != ei_end; ei = next) {
-      ++next;
-      if (source(*ei,g)==u || target(*ei,g)==u){
-        to_remove.push_back(*ei);
-      }
-    }
-    for(auto e : to_remove){
-        g.set_deleted(e);
-    }
-}
-
-template<typename graph_t>
-typename versioned_graph<graph_t>::vertices_size_type
-num_vertices(const versioned_graph<graph_t>& g){
+template<typename graph_t, typename allocator_t>
+typename versioned_graph<graph_t,allocator_t>::vertices_size_type
+num_vertices(const versioned_graph<graph_t,allocator_t>& g){
     return g.num_vertices();
 }
 
-template<typename graph_t>
-typename versioned_graph<graph_t>::edges_size_type
-num_edges(const versioned_graph<graph_t>& g){
+template<typename graph_t, typename allocator_t>
+typename versioned_graph<graph_t,allocator_t>::edges_size_type
+num_edges(const versioned_graph<graph_t,allocator_t>& g){
     return g.num_edges();
 }
 
-template<typename graph_t, typename vertex_descriptor>
-std::pair<typename versioned_graph<graph_t>::out_edge_iterator,
-          typename versioned_graph<graph_t>::out_edge_iterator>
-out_edges(vertex_descriptor u, const versioned_graph<graph_t>& g){
-    typedef versioned_graph<graph_t> graph_type;
+template<typename graph_t, typename allocator_t, typename vertex_descriptor>
+std::pair<typename versioned_graph<graph_t,allocator_t>::out_edge_iterator,
+          typename versioned_graph<graph_t,allocator_t>::out_edge_iterator>
+out_edges(vertex_descriptor u, const versioned_graph<graph_t,allocator_t>& g){
+    typedef versioned_graph<graph_t,allocator_t> graph_type;
 
     typename graph_type::edge_predicate predicate(&g);
     auto base_iter_p = out_edges(u,g.get_base_graph());
@@ -144,11 +100,11 @@ out_edges(vertex_descriptor u, const versioned_graph<graph_t>& g){
     return std::make_pair(iter_begin,iter_end);
 }
 
-template<typename graph_t, typename vertex_descriptor>
-std::pair<typename versioned_graph<graph_t>::out_edge_iterator,
-          typename versioned_graph<graph_t>::out_edge_iterator>
-edge_range(vertex_descriptor u,vertex_descriptor v, const versioned_graph<graph_t>& g){
-    typedef versioned_graph<graph_t> graph_type;
+template<typename graph_t, typename allocator_t, typename vertex_descriptor>
+std::pair<typename versioned_graph<graph_t,allocator_t>::out_edge_iterator,
+          typename versioned_graph<graph_t,allocator_t>::out_edge_iterator>
+edge_range(vertex_descriptor u,vertex_descriptor v, const versioned_graph<graph_t,allocator_t>& g){
+    typedef versioned_graph<graph_t,allocator_t> graph_type;
 
     typename graph_type::edge_predicate predicate(&g);
     auto base_iter_p = edge_range(u,v,g.get_base_graph());
@@ -157,11 +113,11 @@ edge_range(vertex_descriptor u,vertex_descriptor v, const versioned_graph<graph_
     return std::make_pair(iter_begin,iter_end);
 }
 
-template<typename graph_t, typename vertex_descriptor>
-std::pair<typename versioned_graph<graph_t>::in_edge_iterator,
-          typename versioned_graph<graph_t>::in_edge_iterator>
-in_edges(vertex_descriptor u, const versioned_graph<graph_t>& g){
-    typedef versioned_graph<graph_t> graph_type;
+template<typename graph_t, typename allocator_t, typename vertex_descriptor>
+std::pair<typename versioned_graph<graph_t,allocator_t>::in_edge_iterator,
+          typename versioned_graph<graph_t,allocator_t>::in_edge_iterator>
+in_edges(vertex_descriptor u, const versioned_graph<graph_t,allocator_t>& g){
+    typedef versioned_graph<graph_t,allocator_t> graph_type;
 
     typename graph_type::edge_predicate predicate(&g);
     auto base_iter_p = in_edges(u,g.get_base_graph());
@@ -170,165 +126,215 @@ in_edges(vertex_descriptor u, const versioned_graph<graph_t>& g){
     return std::make_pair(iter_begin,iter_end);
 }
 
-template<typename graph_t, typename vertex_descriptor>
-typename versioned_graph<graph_t>::degree_size_type
-out_degree(vertex_descriptor u, const versioned_graph<graph_t>& g){
+template<typename graph_t, typename allocator_t, typename vertex_descriptor>
+typename versioned_graph<graph_t,allocator_t>::degree_size_type
+out_degree(vertex_descriptor u, const versioned_graph<graph_t,allocator_t>& g){
     return g.get_out_degree(u);
 }
 
-template<typename graph_t, typename vertex_descriptor>
-typename versioned_graph<graph_t>::degree_size_type
-in_degree(vertex_descriptor u, const versioned_graph<graph_t>& g){
+template<typename graph_t, typename allocator_t, typename vertex_descriptor>
+typename versioned_graph<graph_t,allocator_t>::degree_size_type
+in_degree(vertex_descriptor u, const versioned_graph<graph_t,allocator_t>& g){
     return g.get_in_degree(u);
 }
 
-template<typename graph_t, typename vertex_descriptor>
-std::pair<typename versioned_graph<graph_t>::adjacency_iterator,
-          typename versioned_graph<graph_t>::adjacency_iterator>
-adjacent_vertices(vertex_descriptor u, const versioned_graph<graph_t>& g){
-    typedef versioned_graph<graph_t> graph_type;
-
-    auto adj = boost::adjacent_vertices(u,g.get_base_graph());
-    typename graph_type::adjacency_predicate predicate(&g,u);
-    typename graph_type::adjacency_iterator iter_begin(predicate, adj.first, adj.second);
-    typename graph_type::adjacency_iterator iter_end(predicate, adj.second, adj.second);
+template<typename graph_t, typename allocator_t, typename vertex_descriptor>
+std::pair<typename versioned_graph<graph_t,allocator_t>::adjacency_iterator,
+          typename versioned_graph<graph_t,allocator_t>::adjacency_iterator>
+adjacent_vertices(vertex_descriptor u, const versioned_graph<graph_t,allocator_t>& g){
+    typedef versioned_graph<graph_t,allocator_t> graph_type;
+    auto edges = out_edges(u,g);
+    typename graph_type::adjacency_iterator iter_begin(edges.first,&g);
+    typename graph_type::adjacency_iterator iter_end(edges.second,&g);
     return std::make_pair(iter_begin,iter_end);
 }
 
-template<typename graph_t, typename vertex_descriptor>
-std::pair<typename versioned_graph<graph_t>::inv_adjacency_iterator,
-          typename versioned_graph<graph_t>::inv_adjacency_iterator>
-inv_adjacent_vertices(vertex_descriptor u, const versioned_graph<graph_t>& g){
-    typedef versioned_graph<graph_t> graph_type;
-
-    auto adj = boost::inv_adjacent_vertices(u,g.get_base_graph());
-    typename graph_type::inv_adjacency_predicate predicate(&g,u);
-    typename graph_type::inv_adjacency_iterator iter_begin(predicate, adj.first, adj.second);
-    typename graph_type::inv_adjacency_iterator iter_end(predicate, adj.second, adj.second);
+template<typename graph_t, typename allocator_t, typename vertex_descriptor>
+std::pair<typename versioned_graph<graph_t,allocator_t>::inv_adjacency_iterator,
+          typename versioned_graph<graph_t,allocator_t>::inv_adjacency_iterator>
+inv_adjacent_vertices(vertex_descriptor u, const versioned_graph<graph_t,allocator_t>& g){
+    typedef versioned_graph<graph_t,allocator_t> graph_type;
+    auto edges = in_edges(u,g);
+    typename graph_type::inv_adjacency_iterator iter_begin(edges.first,&g);
+    typename graph_type::inv_adjacency_iterator iter_end(edges.second,&g);
     return std::make_pair(iter_begin,iter_end);
 }
 
-template<typename graph_t>
-void commit(versioned_graph<graph_t>& g){
+template<typename graph_t, typename allocator_t>
+void commit(versioned_graph<graph_t,allocator_t>& g){
     return g.commit();
 }
 
-template<typename graph_t>
-void undo_commit(versioned_graph<graph_t>& g){
+template<typename graph_t, typename allocator_t>
+void undo_commit(versioned_graph<graph_t,allocator_t>& g){
     return g.undo_commit();
 }
 
-template<typename graph_t>
-void revert_changes(versioned_graph<graph_t>& g){
+template<typename graph_t, typename allocator_t>
+void undo_to(versioned_graph<graph_t,allocator_t>& g, typename versioned_graph<graph_t,allocator_t>::revision rev){
+    return g.undo_to(rev);
+}
+
+template<typename graph_t, typename allocator_t>
+void revert_changes(versioned_graph<graph_t,allocator_t>& g){
     return g.revert_uncommited();
 }
 
-template<typename graph_t>
-void erase_history(versioned_graph<graph_t>& g){
+/**
+ * elements added, removed or modified between committed revisions from and to, see revision_diff
+ */
+template<typename graph_t, typename allocator_t>
+typename versioned_graph<graph_t,allocator_t>::diff_type
+diff(const versioned_graph<graph_t,allocator_t>& g, typename versioned_graph<graph_t,allocator_t>::revision from,
+     typename versioned_graph<graph_t,allocator_t>::revision to){
+    return g.get_diff(from,to);
+}
+
+template<typename graph_t, typename allocator_t>
+void add_observer(versioned_graph<graph_t,allocator_t>& g, typename versioned_graph<graph_t,allocator_t>::observer_type* observer){
+    g.add_observer(observer);
+}
+
+template<typename graph_t, typename allocator_t>
+void remove_observer(versioned_graph<graph_t,allocator_t>& g, typename versioned_graph<graph_t,allocator_t>::observer_type* observer){
+    g.remove_observer(observer);
+}
+
+template<typename graph_t, typename allocator_t>
+void erase_history(versioned_graph<graph_t,allocator_t>& g){
     return g.erase_history();
 }
 
-template<typename graph_t, typename vertex_descriptor>
-void remove_vertex(vertex_descriptor v, versioned_graph<graph_t>& g){
+template<typename graph_t, typename allocator_t, typename vertex_descriptor>
+void remove_vertex(vertex_descriptor v, versioned_graph<graph_t,allocator_t>& g){
     g.set_deleted(v);
 }
 
-template<typename graph_t, typename vertex_descriptor>
-void remove_edge(vertex_descriptor u,vertex_descriptor v, versioned_graph<graph_t>& g){
-    typedef versioned_graph<graph_t> graph_type;
-    typedef typename graph_type::out_edge_iterator out_edge_iterator;
-    out_edge_iterator ei, ei_end, next;
-    boost::tie(ei, ei_end) = out_edges(u,g);
-    std::list<typename graph_type::edge_descriptor> to_remove;
-    for (next = ei; ei != ei_end; ei = next) {
-      ++next;
-        if (target(*ei,g)==v){
-            to_remove.push_back(*ei);
-        }
-    }
-    for(auto e : to_remove){
-        remove_edge(e, g);
-    }
-}
-
-template<typename graph_t, typename edge>
-void remove_edge(edge e, versioned_graph<graph_t>& g){
+template<typename graph_t, typename allocator_t, typename vertex_descriptor>
+void remove_edge(vertex_descriptor u,vertex_descriptor v, versioned_graph<graph_t,allocator_t>& g){
+    typedef typename versioned_graph<graph_t,allocator_t>::edge_descriptor edge_descriptor;
+    typename versioned_graph<graph_t,allocator_t>::vertex_descriptor t = v;
+    g.remove_out_edges_if(u,[&](edge_descriptor e){ return target(e,g)==t; });
+}
+
+template<typename graph_t, typename allocator_t, typename edge>
+void remove_edge(edge e, versioned_graph<graph_t,allocator_t>& g){
     g.set_deleted(e);
 }
 
-template <class predicate, typename vertex_descriptor, typename graph_t>
+template <class predicate, typename vertex_descriptor, typename graph_t, typename allocator_t>
 void remove_out_edge_if(vertex_descriptor u, predicate pred,
-                        versioned_graph<graph_t>& g){
-    typedef versioned_graph<graph_t> graph_type;
-    typedef typename graph_type::out_edge_iterator out_edge_iterator;
-    out_edge_iterator ei, ei_end, next;
-    boost::tie(ei, ei_end) = out_edges(u,g);
-    std::list<typename graph_type::edge_descriptor> to_remove;
-    for (next = ei; ei != ei_end; ei = next) {
-      ++next;
-      if (pred(*ei)){
-          to_remove.push_back(*ei);
-      }
-    }
-    for(auto e : to_remove){
-        remove_edge(e, g);
-    }
-}
-
-template <class predicate, typename vertex_descriptor, typename graph_t>
+                        versioned_graph<graph_t,allocator_t>& g){
+    g.remove_out_edges_if(u,pred);
+}
+
+template <class predicate, typename vertex_descriptor, typename graph_t, typename allocator_t>
 void remove_in_edge_if(vertex_descriptor u, predicate pred,
-                        versioned_graph<graph_t>& g){
-    typedef versioned_graph<graph_t> graph_type;
-    typedef typename graph_type::in_edge_iterator in_edge_iterator;
-    in_edge_iterator ei, ei_end, next;
-    boost::tie(ei, ei_end) = in_edges(u,g);
-    std::list<typename graph_type::edge_descriptor> to_remove;
-    for (next = ei; ei != ei_end; ei = next) {
-      ++next;
-      if (pred(*ei)){
-          to_remove.push_back(*ei);
-      }
-    }
-    for(auto e : to_remove){
-        remove_edge(e, g);
-    }
-}
-
-template <class predicate, typename graph_t>
+                        versioned_graph<graph_t,allocator_t>& g){
+    g.remove_in_edges_if(u,pred);
+}
+
+template <class predicate, typename graph_t, typename allocator_t>
 void
-remove_edge_if(predicate pred, versioned_graph<graph_t>& g)
-{
-  typedef versioned_graph<graph_t> graph_type;
-  typedef typename graph_type::edge_iterator edge_iterator;
-  edge_iterator ei, ei_end, next;
-  boost::tie(ei, ei_end) = edges(g);
-  std::list<typename graph_type::edge_descriptor> to_remove;
-  for (next = ei; ei != ei_end; ei = next) {
-    ++next;
-    if (pred(*ei)){
-        to_remove.push_back(*ei);
-    }
-  }
-  for(auto e : to_remove){
-      remove_edge(e, g);
-  }
+remove_edge_if(predicate pred, versioned_graph<graph_t,allocator_t>& g){
+    g.remove_edges_if(pred);
+}
+
+
+template<typename graph_t, typename allocator_t,typename vertex_size_type>
+typename versioned_graph<graph_t,allocator_t>::vertex_descriptor
+vertex(vertex_size_type n, const versioned_graph<graph_t,allocator_t>& g){
+    return g.get_vertex(n);
+}
 
+template<typename graph_t, typename allocator_t, typename T, typename bundle_t>
+struct property_map<versioned_graph<graph_t,allocator_t>, T bundle_t::*> {
+    typedef versioned_graph<graph_t,allocator_t> graph_type;
+    typedef typename detail::bundle_descriptor<graph_type,bundle_t>::type descriptor;
+    typedef detail::versioned_bundle_property_map<graph_type,descriptor,bundle_t,T> type;
+    typedef detail::versioned_bundle_property_map<const graph_type,descriptor,bundle_t,T> const_type;
+};
+
+/**
+ * bundled member property map, values put by it are marked as modified
+ */
+template<typename graph_t, typename allocator_t, typename T, typename bundle_t>
+typename property_map<versioned_graph<graph_t,allocator_t>, T bundle_t::*>::type
+get(T bundle_t::* p, versioned_graph<graph_t,allocator_t>& g){
+    typedef typename property_map<versioned_graph<graph_t,allocator_t>, T bundle_t::*>::type map_type;
+    return map_type(&g,p);
 }
 
+template<typename graph_t, typename allocator_t, typename T, typename bundle_t>
+typename property_map<versioned_graph<graph_t,allocator_t>, T bundle_t::*>::const_type
+get(T bundle_t::* p, const versioned_graph<graph_t,allocator_t>& g){
+    typedef typename property_map<versioned_graph<graph_t,allocator_t>, T bundle_t::*>::const_type map_type;
+    return map_type(&g,p);
+}
 
-template<typename graph_t,typename vertex_size_type>
-typename versioned_graph<graph_t>::vertex_descriptor
-vertex(vertex_size_type n, const versioned_graph<graph_t>& g){
-    typedef versioned_graph<graph_t> graph_type;
-    typename graph_type::vertex_iterator it,end;
-    tie(it,end) = vertices(g);
-    std::advance(it,n);
-    return *it;
+template<typename graph_t, typename allocator_t, typename T, typename bundle_t, typename key_type>
+const T&
+get(T bundle_t::* p, const versioned_graph<graph_t,allocator_t>& g, const key_type& k){
+    return g[k].*p;
 }
 
+template<typename graph_t, typename allocator_t, typename T, typename bundle_t, typename key_type, typename value_type>
+void
+put(T bundle_t::* p, versioned_graph<graph_t,allocator_t>& g, const key_type& k, const value_type& v){
+    g[k].*p = v;
 }
 
+template<typename graph_t, typename allocator_t>
+struct property_map<versioned_graph<graph_t,allocator_t>, vertex_index_t> {
+    typedef versioned_graph<graph_t,allocator_t> graph_type;
+    typedef detail::versioned_index_map<graph_type,
+                                        typename graph_type::vertex_descriptor,
+                                        typename graph_type::vertices_size_type> type;
+    typedef type const_type;
+};
+
+template<typename graph_t, typename allocator_t>
+struct property_map<versioned_graph<graph_t,allocator_t>, edge_index_t> {
+    typedef versioned_graph<graph_t,allocator_t> graph_type;
+    typedef detail::versioned_index_map<graph_type,
+                                        typename graph_type::edge_descriptor,
+                                        typename graph_type::edges_size_type> type;
+    typedef type const_type;
+};
+
+/**
+ * compact index of not deleted vertices, in range 0..num_vertices(g)-1,
+ * index of vertex changes when other vertex is removed
+ */
+template<typename graph_t, typename allocator_t>
+typename property_map<versioned_graph<graph_t,allocator_t>, vertex_index_t>::const_type
+get(vertex_index_t, const versioned_graph<graph_t,allocator_t>& g){
+    typedef typename property_map<versioned_graph<graph_t,allocator_t>, vertex_index_t>::const_type map_type;
+    return map_type(&g);
+}
 
+template<typename graph_t, typename allocator_t>
+typename versioned_graph<graph_t,allocator_t>::vertices_size_type
+get(vertex_index_t, const versioned_graph<graph_t,allocator_t>& g, typename versioned_graph<graph_t,allocator_t>::vertex_descriptor v){
+    return g.get_index(v);
+}
 
+/**
+ * compact index of not deleted edges, in range 0..num_edges(g)-1
+ */
+template<typename graph_t, typename allocator_t>
+typename property_map<versioned_graph<graph_t,allocator_t>, edge_index_t>::const_type
+get(edge_index_t, const versioned_graph<graph_t,allocator_t>& g){
+    typedef typename property_map<versioned_graph<graph_t,allocator_t>, edge_index_t>::const_type map_type;
+    return map_type(&g);
+}
+
+template<typename graph_t, typename allocator_t>
+typename versioned_graph<graph_t,allocator_t>::edges_size_type
+get(edge_index_t, const versioned_graph<graph_t,allocator_t>& g, typename versioned_graph<graph_t,allocator_t>::edge_descriptor e){
+    return g.get_index(e);
+}
+
+}
 
 #endif // VERSIONED_GRAPH_NON_MEMBERS_H
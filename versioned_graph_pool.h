@@ -0,0 +1,248 @@
+/***
+ * author: Damian Lipka
+ *
+ * */
+
+#ifndef VERSIONED_GRAPH_POOL_H
+#define VERSIONED_GRAPH_POOL_H
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+namespace boost {
+
+namespace detail {
+
+/**
+ * Pool of memory blocks in size classes of 16 bytes up to max_block_size bytes,
+ * larger requests go directly to operator new. Blocks are carved from chunks
+ * which are never returned to the system, freed block is pushed on free list of its class
+ * and reused by the next allocation of that class, both in constant time without operator new.
+ * Rest of chunk too small for a request is kept as free block of the class it fits.
+ * Free lists are kept per thread, list longer than max_cached_bytes and lists of finished
+ * thread go to shared lists, which are taken before a new block is carved,
+ * so blocks freed by other thread than the one which allocated them are reused.
+ */
+class block_pool {
+public:
+    static const std::size_t granularity = 16;
+    static const std::size_t max_block_size = 4096;
+    static const std::size_t chunk_size = 64*1024;
+    static const std::size_t class_count = max_block_size/granularity;
+    static const std::size_t max_cached_bytes = 256*1024; // per class and thread
+
+    static void* allocate(std::size_t bytes){
+        if(bytes>max_block_size){
+            return ::operator new(bytes);
+        }
+        const std::size_t c = size_class(bytes);
+        thread_cache& cache = local();
+        free_block* block = cache.lists[c];
+        if(block){
+            cache.lists[c] = block->next;
+            --cache.counts[c];
+            return block;
+        }
+        return refill(cache,c);
+    }
+
+    static void deallocate(void* p, std::size_t bytes){
+        if(bytes>max_block_size){
+            ::operator delete(p);
+            return;
+        }
+        const std::size_t c = size_class(bytes);
+        thread_cache& cache = local();
+        if(!cache.registered){
+            register_thread(cache);
+        }
+        free_block* block = static_cast<free_block*>(p);
+        if(cache.finished){
+            // thread local lists are gone, for example in destructors of static objects
+            block->next = 0;
+            give_away(c,block,1);
+            return;
+        }
+        block->next = cache.lists[c];
+        cache.lists[c] = block;
+        if(++cache.counts[c]*block_size(c)>max_cached_bytes){
+            // blocks freed here for other threads are not kept forever
+            give_away(c,cache.lists[c],cache.counts[c]);
+            cache.lists[c] = 0;
+            cache.counts[c] = 0;
+        }
+    }
+
+private:
+    struct free_block {
+        free_block* next;
+    };
+    /**
+     * per thread state, zero initialized, so it needs no guard on access
+     */
+    struct thread_cache {
+        free_block* lists[class_count];
+        std::size_t counts[class_count];
+        char* cursor; // free rest of current chunk
+        char* limit;
+        bool registered;
+        bool finished;
+    };
+    struct shared_lists {
+        std::mutex mutex;
+        free_block* lists[class_count];
+        std::atomic<std::size_t> counts[class_count]; // read without lock to skip empty lists
+    };
+    /**
+     * hands free lists and rest of chunk of finishing thread over to shared lists
+     */
+    struct thread_guard {
+        thread_cache* cache;
+        explicit thread_guard(thread_cache* cache) : cache(cache) {}
+        ~thread_guard(){
+            keep_rest(*cache);
+            for(std::size_t c=0;c<class_count;++c){
+                if(cache->lists[c]){
+                    give_away(c,cache->lists[c],cache->counts[c]);
+                    cache->lists[c] = 0;
+                    cache->counts[c] = 0;
+                }
+            }
+            cache->finished = true;
+        }
+    };
+
+    static std::size_t size_class(std::size_t bytes){
+        return bytes ? (bytes-1)/granularity : 0;
+    }
+    static std::size_t block_size(std::size_t c){
+        return (c+1)*granularity;
+    }
+    static thread_cache& local(){
+        static thread_local thread_cache cache;
+        return cache;
+    }
+    /**
+     * never destroyed, blocks may be freed during destruction of static objects
+     */
+    static shared_lists& orphans(){
+        static shared_lists* shared = new shared_lists();
+        return *shared;
+    }
+    /**
+     * appends list of count blocks to shared list of class c
+     */
+    static void give_away(std::size_t c, free_block* list, std::size_t count){
+        free_block* last = list;
+        while(last->next){
+            last = last->next;
+        }
+        shared_lists& shared = orphans();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        last->next = shared.lists[c];
+        shared.lists[c] = list;
+        shared.counts[c] += count;
+    }
+    /**
+     * moves shared list of class c to empty list of this thread
+     */
+    static void take_shared(thread_cache& cache, std::size_t c){
+        shared_lists& shared = orphans();
+        if(shared.counts[c].load(std::memory_order_relaxed)==0){
+            return;
+        }
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        cache.lists[c] = shared.lists[c];
+        cache.counts[c] = shared.counts[c];
+        shared.lists[c] = 0;
+        shared.counts[c] = 0;
+    }
+    static void register_thread(thread_cache& cache){
+        cache.registered = true;
+        static thread_local thread_guard guard(&cache);
+    }
+    /**
+     * rest of current chunk becomes free blocks of the largest classes it fits
+     */
+    static void keep_rest(thread_cache& cache){
+        std::size_t rest = cache.limit-cache.cursor;
+        while(rest>=granularity){
+            const std::size_t size = rest<max_block_size ? rest-rest%granularity : max_block_size;
+            const std::size_t c = size_class(size);
+            free_block* block = reinterpret_cast<free_block*>(cache.cursor);
+            block->next = cache.lists[c];
+            cache.lists[c] = block;
+            ++cache.counts[c];
+            cache.cursor += size;
+            rest -= size;
+        }
+        cache.cursor = cache.limit = 0;
+    }
+    static void* refill(thread_cache& cache, std::size_t c){
+        if(!cache.registered){
+            register_thread(cache);
+        }
+        if(!cache.finished){
+            take_shared(cache,c);
+            if(cache.lists[c]){
+                free_block* block = cache.lists[c];
+                cache.lists[c] = block->next;
+                --cache.counts[c];
+                return block;
+            }
+        }
+        const std::size_t size = block_size(c);
+        if(cache.finished){
+            return ::operator new(size);
+        }
+        if(std::size_t(cache.limit-cache.cursor)<size){
+            keep_rest(cache);
+            cache.cursor = static_cast<char*>(::operator new(chunk_size));
+            cache.limit = cache.cursor+chunk_size;
+        }
+        void* p = cache.cursor;
+        cache.cursor += size;
+        return p;
+    }
+};
+
+/**
+ * Stateless allocator taking memory from block_pool, opt-in allocator passed as allocator_t
+ * parameter of versioned_graph, std::allocator<char> stays the default
+ */
+template<typename T>
+struct pool_allocator {
+    typedef T value_type;
+
+    pool_allocator() {}
+    template<typename U>
+    pool_allocator(const pool_allocator<U>&) {}
+
+    template<typename U>
+    struct rebind {
+        typedef pool_allocator<U> other;
+    };
+
+    T* allocate(std::size_t n){
+        return static_cast<T*>(block_pool::allocate(n*sizeof(T)));
+    }
+    void deallocate(T* p, std::size_t n){
+        block_pool::deallocate(p,n*sizeof(T));
+    }
+};
+
+template<typename T, typename U>
+bool operator==(const pool_allocator<T>&, const pool_allocator<U>&){
+    return true;
+}
+template<typename T, typename U>
+bool operator!=(const pool_allocator<T>&, const pool_allocator<U>&){
+    return false;
+}
+
+}
+
+}
+
+#endif // VERSIONED_GRAPH_POOL_H
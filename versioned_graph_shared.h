@@ -0,0 +1,81 @@
+/***
+ * author: Damian Lipka
+ *
+ * */
+
+#ifndef VERSIONED_GRAPH_SHARED_H
+#define VERSIONED_GRAPH_SHARED_H
+#include "versioned_graph.h"
+#include <memory>
+
+namespace boost {
+
+/**
+ * Bundle holding immutable value shared by reference counting, used as vertex, edge
+ * or graph bundle of versioned graph instead of T. Graph, history records, undo
+ * and copies of graph share single value, commit() only copies pointer.
+ * Value is read by get() or ->, modify() copies value only if it is shared,
+ * so the value kept in history is never changed. Default constructed bundle
+ * shares one default value and allocates nothing.
+ */
+template<typename T>
+class shared_bundle {
+public:
+    typedef T value_type;
+
+    shared_bundle() {}
+    shared_bundle(const T& value) : value(std::make_shared<T>(value)) {}
+    shared_bundle(T&& value) : value(std::make_shared<T>(std::move(value))) {}
+
+    const T& get() const{
+        return value ? *value : default_value();
+    }
+    const T& operator*() const{
+        return get();
+    }
+    const T* operator->() const{
+        return &get();
+    }
+
+    /**
+     * value for writing, not shared with history or other bundles
+     */
+    T& modify(){
+        if(!value){
+            value = std::make_shared<T>();
+        } else if(value.use_count()>1){
+            value = std::make_shared<T>(*value);
+        }
+        return *value;
+    }
+
+    /**
+     * checks if both bundles refer to the same value without comparing values
+     */
+    bool shares(const shared_bundle& other) const{
+        return value==other.value;
+    }
+private:
+    static const T& default_value(){
+        static const T value = T();
+        return value;
+    }
+    std::shared_ptr<T> value;
+};
+
+/**
+ * values are compared only if they are not shared, values of type without
+ * operator!= differ if they are not shared
+ */
+template<typename T>
+bool operator!=(const shared_bundle<T>& a, const shared_bundle<T>& b){
+    return !a.shares(b) && detail::values_differ(a.get(),b.get());
+}
+template<typename T>
+bool operator==(const shared_bundle<T>& a, const shared_bundle<T>& b){
+    return !(a!=b);
+}
+
+}
+
+#endif // VERSIONED_GRAPH_SHARED_H
@@ -0,0 +1,211 @@
+/***
+ * author: Damian Lipka
+ *
+ * */
+
+#ifndef VERSIONED_GRAPH_VIEW_H
+#define VERSIONED_GRAPH_VIEW_H
+#include "versioned_graph.h"
+#include <boost/iterator/filter_iterator.hpp>
+
+namespace boost {
+
+namespace detail {
+
+/**
+ * Predicate to decide if edge or vertex existed in revision of view
+ */
+template<typename view_type,typename value_type>
+struct existed_in_predicate{
+    const view_type* view;
+    existed_in_predicate() : view(nullptr) {}
+    existed_in_predicate(const view_type* view) : view(view) {}
+    bool operator()(const value_type& d) const {
+        return existed_in(view->source_graph().get_history(d),view->get_revision());
+    }
+};
+
+}
+
+/**
+ * Read only view of versioned graph as it was committed in given revision,
+ * models VertexListGraph, EdgeListGraph, IncidenceGraph and AdjacencyGraph.
+ * Elements and bundles are read from history records, graph is not modified.
+ * Descriptors are descriptors of versioned graph, view is valid until graph is modified.
+ */
+template<typename graph_t, typename allocator_t = detail::default_allocator>
+class revision_view {
+public:
+    typedef revision_view<graph_t,allocator_t> self_type;
+    typedef versioned_graph<graph_t,allocator_t> source_type;
+    typedef typename source_type::revision revision;
+    typedef typename source_type::vertex_bundled vertex_bundled;
+    typedef typename source_type::edge_bundled edge_bundled;
+    typedef typename source_type::graph_bundled graph_bundled;
+    typedef typename source_type::vertex_bundled_reference vertex_bundled_reference;
+    typedef typename source_type::edge_bundled_reference edge_bundled_reference;
+    typedef typename source_type::graph_bundled_reference graph_bundled_reference;
+
+    typedef typename source_type::vertex_descriptor vertex_descriptor;
+    typedef typename source_type::edge_descriptor edge_descriptor;
+    typedef typename source_type::directed_category directed_category;
+    typedef typename source_type::edge_parallel_category edge_parallel_category;
+    struct traversal_category : public virtual incidence_graph_tag,
+                                public virtual adjacency_graph_tag,
+                                public virtual vertex_list_graph_tag,
+                                public virtual edge_list_graph_tag {};
+    typedef typename source_type::vertices_size_type vertices_size_type;
+    typedef typename source_type::edges_size_type edges_size_type;
+    typedef typename source_type::degree_size_type degree_size_type;
+
+    typedef detail::existed_in_predicate<self_type,vertex_descriptor> vertex_predicate;
+    typedef detail::existed_in_predicate<self_type,edge_descriptor> edge_predicate;
+    typedef filter_iterator<vertex_predicate,typename graph_traits<graph_t>::vertex_iterator> vertex_iterator;
+    typedef filter_iterator<edge_predicate,typename graph_traits<graph_t>::edge_iterator> edge_iterator;
+    typedef filter_iterator<edge_predicate,typename graph_traits<graph_t>::out_edge_iterator> out_edge_iterator;
+    typedef typename adjacency_iterator_generator<self_type,vertex_descriptor,out_edge_iterator>::type adjacency_iterator;
+
+    static vertex_descriptor null_vertex(){
+        return graph_traits<graph_t>::null_vertex();
+    }
+
+    /**
+     * view of revision r, which has to be already committed
+     */
+    revision_view(const source_type& g, revision r) : g(&g),rev(r),vertex_count(unknown),edge_count(unknown) {
+        assert(r<g.get_current_rev() && "Revision is not committed");
+    }
+
+    const source_type& source_graph() const{
+        return *g;
+    }
+    revision get_revision() const{
+        return rev;
+    }
+
+    vertex_bundled_reference operator[](vertex_descriptor v) const{
+        return detail::get_value(*detail::find_record(g->get_history(v),rev));
+    }
+    edge_bundled_reference operator[](edge_descriptor e) const{
+        return detail::get_value(*detail::find_record(g->get_history(e),rev));
+    }
+    graph_bundled_reference operator[](graph_bundle_t) const{
+        return g->get_from_history(rev);
+    }
+
+    std::pair<vertex_iterator,vertex_iterator> get_vertices() const{
+        const graph_t& base = g->get_base_graph();
+        vertex_predicate pred(this);
+        return std::make_pair(vertex_iterator(pred,boost::vertices(base).first,boost::vertices(base).second),
+                              vertex_iterator(pred,boost::vertices(base).second,boost::vertices(base).second));
+    }
+    std::pair<edge_iterator,edge_iterator> get_edges() const{
+        const graph_t& base = g->get_base_graph();
+        edge_predicate pred(this);
+        return std::make_pair(edge_iterator(pred,boost::edges(base).first,boost::edges(base).second),
+                              edge_iterator(pred,boost::edges(base).second,boost::edges(base).second));
+    }
+    std::pair<out_edge_iterator,out_edge_iterator> get_out_edges(vertex_descriptor v) const{
+        auto range = boost::out_edges(v,g->get_base_graph());
+        edge_predicate pred(this);
+        return std::make_pair(out_edge_iterator(pred,range.first,range.second),
+                              out_edge_iterator(pred,range.second,range.second));
+    }
+
+    /**
+     * counted on first call, history is not stored per revision
+     */
+    vertices_size_type num_vertices() const{
+        if(vertex_count==unknown){
+            auto range = get_vertices();
+            vertex_count = std::distance(range.first,range.second);
+        }
+        return vertex_count;
+    }
+    edges_size_type num_edges() const{
+        if(edge_count==unknown){
+            auto range = get_edges();
+            edge_count = std::distance(range.first,range.second);
+        }
+        return edge_count;
+    }
+private:
+    static const std::size_t unknown = std::size_t(-1);
+    const source_type* g;
+    revision rev;
+    mutable std::size_t vertex_count;
+    mutable std::size_t edge_count;
+};
+
+/**
+ * state of g committed in revision r, see revision_view
+ */
+template<typename graph_t, typename allocator_t>
+revision_view<graph_t,allocator_t> as_of(const versioned_graph<graph_t,allocator_t>& g, typename versioned_graph<graph_t,allocator_t>::revision r){
+    return revision_view<graph_t,allocator_t>(g,r);
+}
+
+template<typename graph_t, typename allocator_t>
+std::pair<typename revision_view<graph_t,allocator_t>::vertex_iterator,
+          typename revision_view<graph_t,allocator_t>::vertex_iterator>
+vertices(const revision_view<graph_t,allocator_t>& g){
+    return g.get_vertices();
+}
+
+template<typename graph_t, typename allocator_t>
+std::pair<typename revision_view<graph_t,allocator_t>::edge_iterator,
+          typename revision_view<graph_t,allocator_t>::edge_iterator>
+edges(const revision_view<graph_t,allocator_t>& g){
+    return g.get_edges();
+}
+
+template<typename graph_t, typename allocator_t>
+std::pair<typename revision_view<graph_t,allocator_t>::out_edge_iterator,
+          typename revision_view<graph_t,allocator_t>::out_edge_iterator>
+out_edges(typename revision_view<graph_t,allocator_t>::vertex_descriptor v, const revision_view<graph_t,allocator_t>& g){
+    return g.get_out_edges(v);
+}
+
+template<typename graph_t, typename allocator_t>
+std::pair<typename revision_view<graph_t,allocator_t>::adjacency_iterator,
+          typename revision_view<graph_t,allocator_t>::adjacency_iterator>
+adjacent_vertices(typename revision_view<graph_t,allocator_t>::vertex_descriptor v, const revision_view<graph_t,allocator_t>& g){
+    typedef typename revision_view<graph_t,allocator_t>::adjacency_iterator iterator;
+    auto range = g.get_out_edges(v);
+    return std::make_pair(iterator(range.first,&g),iterator(range.second,&g));
+}
+
+template<typename graph_t, typename allocator_t>
+typename revision_view<graph_t,allocator_t>::degree_size_type
+out_degree(typename revision_view<graph_t,allocator_t>::vertex_descriptor v, const revision_view<graph_t,allocator_t>& g){
+    auto range = g.get_out_edges(v);
+    return std::distance(range.first,range.second);
+}
+
+template<typename graph_t, typename allocator_t>
+typename revision_view<graph_t,allocator_t>::vertex_descriptor
+source(typename revision_view<graph_t,allocator_t>::edge_descriptor e, const revision_view<graph_t,allocator_t>& g){
+    return boost::source(e,g.source_graph().get_base_graph());
+}
+
+template<typename graph_t, typename allocator_t>
+typename revision_view<graph_t,allocator_t>::vertex_descriptor
+target(typename revision_view<graph_t,allocator_t>::edge_descriptor e, const revision_view<graph_t,allocator_t>& g){
+    return boost::target(e,g.source_graph().get_base_graph());
+}
+
+template<typename graph_t, typename allocator_t>
+typename revision_view<graph_t,allocator_t>::vertices_size_type
+num_vertices(const revision_view<graph_t,allocator_t>& g){
+    return g.num_vertices();
+}
+
+template<typename graph_t, typename allocator_t>
+typename revision_view<graph_t,allocator_t>::edges_size_type
+num_edges(const revision_view<graph_t,allocator_t>& g){
+    return g.num_edges();
+}
+
+}
+
+#endif // VERSIONED_GRAPH_VIEW_H